@@ -17,6 +17,18 @@ uint32 astar::Node::get_score() const {
     return G + H;
 }
 
+astar::NavigationSnapshot::NavigationSnapshot(const Navigation& source)
+    : path_solids(source.path_solids->snapshot()),
+      off_road_solids(source.off_road_solids->snapshot()),
+      unstandable_solids(source.unstandable_solids->snapshot()),
+      ramps(*source.ramps),
+      navigation(source) {
+    navigation.path_solids        = &path_solids;
+    navigation.off_road_solids    = &off_road_solids;
+    navigation.unstandable_solids = &unstandable_solids;
+    navigation.ramps              = &ramps;
+}
+
 NavigationPath astar::Navigation::find_path(v3i source, v3i target, float tolerance) {
     shared_ptr<Node>         current = nullptr;
     vector<shared_ptr<Node>> open_set, closed_set;
@@ -48,5 +48,18 @@ struct Navigation {
     static const vector<v3i> directions;
 };
 
+// Owns snapshots of everything a Navigation reads, so find_path can run on another thread while the source maps are edited
+struct NavigationSnapshot {
+    Bitmask3D path_solids;
+    Bitmask3D off_road_solids;
+    Bitmask3D unstandable_solids;
+    umap<v3i, Direction> ramps;
+    Navigation navigation;
+
+    explicit NavigationSnapshot(const Navigation& source);
+    NavigationSnapshot(const NavigationSnapshot&) = delete;
+    NavigationSnapshot& operator=(const NavigationSnapshot&) = delete;
+};
+
 }
 
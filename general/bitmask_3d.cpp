@@ -1,25 +1,55 @@
 ﻿#include "general/bitmask_3d.hpp"
 
+#include <algorithm>
+#include <cstring>
+
 #include "extension/fmt.hpp"
 #include "extension/fmt_geometry.hpp"
 
 namespace spellbook {
 
+// Both sides share the storage now, whichever writes first copies it. The flag is only written when it's still
+// false, copies of a snapshot happen on reader threads and the snapshot's flag is already set.
+Bitmask3D::Bitmask3D(const Bitmask3D& other)
+    : chunk_storage(other.chunk_storage), storage_shared(true), version(other.version), journal(other.journal),
+      journal_start(other.journal_start), journal_limit(other.journal_limit) {
+    if (!other.storage_shared)
+        other.storage_shared = true;
+}
+
+Bitmask3D& Bitmask3D::operator=(const Bitmask3D& other) {
+    if (this == &other)
+        return *this;
+    chunk_storage  = other.chunk_storage;
+    storage_shared = true;
+    version        = other.version;
+    journal        = other.journal;
+    journal_start  = other.journal_start;
+    journal_limit  = other.journal_limit;
+    if (!other.storage_shared)
+        other.storage_shared = true;
+    return *this;
+}
+
 void Bitmask3D::set(v3i pos, bool on) {
     v3i chunk_index = math::floor_cast(v3(pos) / v3(4.0f));
     v3i local_pos = pos - chunk_index * v3i(4);
     uint8 bit_index = local_pos.z * 4 * 4 + local_pos.y * 4 + local_pos.x;
-    
-    if (!chunks.contains(chunk_index))
-        chunks[chunk_index] = 0;
-    if (on)
-        chunks[chunk_index] |= 0b1ull << bit_index;
-    else
-        chunks[chunk_index] &= ~(0b1ull << bit_index);
+
+    // Check before detaching, so no-op writes don't copy shared storage or bump the version
+    auto it = chunk_storage->find(chunk_index);
+    uint64 old_bits = it != chunk_storage->end() ? it->second : 0;
+    uint64 new_bits = on ? old_bits | (0b1ull << bit_index) : old_bits & ~(0b1ull << bit_index);
+    if (new_bits == old_bits && it != chunk_storage->end())
+        return;
+
+    _mutable_chunks()[chunk_index] = new_bits;
+    _record_change(chunk_index);
 }
 
 bool Bitmask3D::get(v3i pos) const {
     v3i chunk_index = math::floor_cast(v3(pos) / v3(4.0f));
+    const ChunkMap& chunks = *chunk_storage;
     if (!chunks.contains(chunk_index))
         return false;
     v3i local_pos = pos - chunk_index * v3i(4);
@@ -28,13 +58,116 @@ bool Bitmask3D::get(v3i pos) const {
 }
 
 void Bitmask3D::clear() {
-    chunks.clear();
+    shared_ptr<ChunkMap> old_storage = chunk_storage;
+    chunk_storage = make_shared<ChunkMap>();
+    storage_shared = false;
+    _record_reset(*old_storage);
 }
 
+Bitmask3D Bitmask3D::snapshot() const {
+    Bitmask3D snapshot;
+    snapshot.chunk_storage = chunk_storage;
+    snapshot.version       = version;
+    snapshot.journal_start = version;
+    if (!storage_shared)
+        storage_shared = true;
+    snapshot.storage_shared = true;
+    return snapshot;
+}
+
+Bitmask3D::ChunkMap& Bitmask3D::_mutable_chunks() {
+    if (storage_shared) {
+        chunk_storage = make_shared<ChunkMap>(*chunk_storage);
+        storage_shared = false;
+    }
+    return *chunk_storage;
+}
+
+void Bitmask3D::_record_change(v3i chunk_index) {
+    version++;
+    // Consecutive writes to one chunk only need the latest version
+    if (!journal.empty() && journal.back().chunk_index == chunk_index)
+        journal.back().version = version;
+    else
+        journal.push_back(Bitmask3DChange{version, chunk_index});
+
+    if (journal.size() > journal_limit) {
+        uint32 trimmed = journal.size() - journal_limit / 2;
+        journal_start = journal[trimmed - 1].version;
+        journal.remove_indices(0, trimmed, false);
+    }
+
+    // a callback that writes pushes onto or trims the journal, so it gets a copy
+    Bitmask3DChange change = journal.back();
+    listeners.dispatch(change);
+}
+
+// For bulk replacements of the storage, polling consumers rebuild from scratch while listeners still hear
+// about every chunk that was or now is present
+void Bitmask3D::_record_reset(const ChunkMap& old_chunks) {
+    version++;
+    journal.clear();
+    journal_start = version;
+
+    if (listeners.callbacks.empty())
+        return;
+    // a callback could write and replace the storage, the new chunks are taken up front
+    shared_ptr<ChunkMap> new_storage = chunk_storage;
+    for (auto& [chunk_index, _] : old_chunks)
+        listeners.dispatch(Bitmask3DChange{version, chunk_index});
+    for (auto& [chunk_index, _] : *new_storage) {
+        if (!old_chunks.contains(chunk_index))
+            listeners.dispatch(Bitmask3DChange{version, chunk_index});
+    }
+}
+
+bool Bitmask3D::changes_since(uint64 since_version, uset<v3i>& dirty_chunks) const {
+    if (since_version < journal_start)
+        return false;
+    for (int32 i = int32(journal.size()) - 1; i >= 0 && journal[i].version > since_version; i--)
+        dirty_chunks.insert(journal[i].chunk_index);
+    return true;
+}
+
+void Bitmask3DListeners::dispatch(const Bitmask3DChange& change) {
+    dispatch_depth++;
+    for (Callback& callback : callbacks) {
+        if (callback.first != 0)
+            callback.second(change);
+    }
+    if (--dispatch_depth > 0)
+        return;
+    callbacks.remove_if([](const Callback& callback) { return callback.first == 0; }, false);
+    for (Callback& callback : added)
+        callbacks.push_back(std::move(callback));
+    added.clear();
+}
+
+uint64 Bitmask3D::subscribe(const function<void(const Bitmask3DChange&)>& callback) {
+    uint64 id = listeners.next_id++;
+    if (listeners.dispatch_depth > 0)
+        listeners.added.emplace_back(id, callback);
+    else
+        listeners.callbacks.emplace_back(id, callback);
+    return id;
+}
+
+void Bitmask3D::unsubscribe(uint64 id) {
+    auto matches = [id](const Bitmask3DListeners::Callback& callback) { return callback.first == id; };
+    listeners.added.remove_if(matches, false);
+    if (listeners.dispatch_depth == 0) {
+        listeners.callbacks.remove_if(matches, false);
+        return;
+    }
+    for (Bitmask3DListeners::Callback& callback : listeners.callbacks) {
+        if (matches(callback))
+            callback.first = 0;
+    }
+}
 
 v3i Bitmask3D::rough_min() const {
     v3i min_id = v3i(INT_MAX);
-    for (auto& [chunk_id, _] : chunks) {
+    for (auto& [chunk_id, _] : chunks()) {
         if (chunk_id.x < min_id.x)
             min_id.x = chunk_id.x;
         if (chunk_id.y < min_id.y)
@@ -48,7 +181,7 @@ v3i Bitmask3D::rough_min() const {
 }
 v3i Bitmask3D::rough_max() const {
     v3i max_id = v3i(-INT_MAX);
-    for (auto& [chunk_id, _] : chunks) {
+    for (auto& [chunk_id, _] : chunks()) {
         if (chunk_id.x > max_id.x)
             max_id.x = chunk_id.x;
         if (chunk_id.y > max_id.y)
@@ -114,4 +247,147 @@ bool ray_intersection(const Bitmask3D& bitmask, ray3 ray, v3& pos, v3i& open_cub
     return false;
 }
 
+static bool chunk_order(v3i lhs, v3i rhs) {
+    if (lhs.z != rhs.z)
+        return lhs.z < rhs.z;
+    if (lhs.y != rhs.y)
+        return lhs.y < rhs.y;
+    return lhs.x < rhs.x;
+}
+
+void write_bitmask_binary(const Bitmask3D& bitmask, vector<uint8>& out) {
+    vector<std::pair<v3i, uint64>> sorted;
+    sorted.reserve(bitmask.chunks().size());
+    for (auto& [chunk_index, bits] : bitmask.chunks()) {
+        if (bits != 0)
+            sorted.emplace_back(chunk_index, bits);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const std::pair<v3i, uint64>& lhs, const std::pair<v3i, uint64>& rhs) {
+        return chunk_order(lhs.first, rhs.first);
+    });
+
+    vector<Bitmask3DRun> runs;
+    vector<uint64> payload;
+    for (uint32 i = 0; i < sorted.size();) {
+        bool full = sorted[i].second == ~0ull;
+        uint32 j = i;
+        while (j < sorted.size() && sorted[j].first == sorted[i].first + v3i(int32(j - i), 0, 0) && (sorted[j].second == ~0ull) == full) {
+            if (!full)
+                payload.push_back(sorted[j].second);
+            j++;
+        }
+        uint32 payload_index = full ? Bitmask3DBinaryHeader::full_payload : payload.size() - (j - i);
+        runs.push_back(Bitmask3DRun{sorted[i].first, j - i, payload_index});
+        i = j;
+    }
+
+    Bitmask3DBinaryHeader header;
+    header.magic         = Bitmask3DBinaryHeader::magic_value;
+    header.version       = Bitmask3DBinaryHeader::current_version;
+    header.run_count     = runs.size();
+    header.payload_count = payload.size();
+
+    // payload is 8 byte aligned relative to the start of the blob so the view can read it in place
+    uint32 runs_end      = sizeof(Bitmask3DBinaryHeader) + runs.bsize();
+    uint32 payload_start = (runs_end + 7) & ~7u;
+    out.clear();
+    out.resize(payload_start + payload.bsize());
+    memcpy(out.data(), &header, sizeof(Bitmask3DBinaryHeader));
+    if (!runs.empty())
+        memcpy(out.data() + sizeof(Bitmask3DBinaryHeader), runs.data(), runs.bsize());
+    if (!payload.empty())
+        memcpy(out.data() + payload_start, payload.data(), payload.bsize());
+}
+
+bool read_bitmask_binary(span<const uint8> data, Bitmask3D& bitmask) {
+    // the view reads in place, so a misaligned blob is copied somewhere aligned first
+    vector<uint64> aligned;
+    if (uintptr_t(data.data()) % alignof(uint64) != 0) {
+        aligned.resize((data.size() + 7) / 8);
+        memcpy(aligned.data(), data.data(), data.size());
+        data = span<const uint8>((const uint8*) aligned.data(), data.size());
+    }
+    Bitmask3DView view;
+    if (!view.load(data))
+        return false;
+
+    uint32 chunk_count = 0;
+    for (const Bitmask3DRun& run : view.runs)
+        chunk_count += run.length;
+
+    shared_ptr<Bitmask3D::ChunkMap> old_storage = bitmask.chunk_storage;
+    auto new_storage = make_shared<Bitmask3D::ChunkMap>();
+    Bitmask3D::ChunkMap& chunks = *new_storage;
+    chunks.reserve(chunk_count);
+    for (const Bitmask3DRun& run : view.runs) {
+        for (uint32 i = 0; i < run.length; i++) {
+            uint64 bits = run.payload == Bitmask3DBinaryHeader::full_payload ? ~0ull : view.payload[run.payload + i];
+            chunks.emplace(run.start + v3i(int32(i), 0, 0), bits);
+        }
+    }
+    bitmask.chunk_storage = std::move(new_storage);
+    bitmask.storage_shared = false;
+    bitmask._record_reset(*old_storage);
+    return true;
+}
+
+bool Bitmask3DView::load(span<const uint8> data) {
+    runs    = {};
+    payload = {};
+    if (data.size() < sizeof(Bitmask3DBinaryHeader) || uintptr_t(data.data()) % alignof(uint64) != 0)
+        return false;
+
+    Bitmask3DBinaryHeader header;
+    memcpy(&header, data.data(), sizeof(Bitmask3DBinaryHeader));
+    if (header.magic != Bitmask3DBinaryHeader::magic_value || header.version != Bitmask3DBinaryHeader::current_version)
+        return false;
+
+    uint64 runs_end      = sizeof(Bitmask3DBinaryHeader) + uint64(header.run_count) * sizeof(Bitmask3DRun);
+    uint64 payload_start = (runs_end + 7) & ~7ull;
+    if (payload_start + uint64(header.payload_count) * sizeof(uint64) > data.size())
+        return false;
+
+    span<const Bitmask3DRun> new_runs((const Bitmask3DRun*) (data.data() + sizeof(Bitmask3DBinaryHeader)), header.run_count);
+    for (uint32 i = 0; i < new_runs.size(); i++) {
+        const Bitmask3DRun& run = new_runs[i];
+        if (run.length == 0 || int64(run.start.x) + run.length > INT_MAX)
+            return false;
+        if (run.payload != Bitmask3DBinaryHeader::full_payload && uint64(run.payload) + run.length > header.payload_count)
+            return false;
+        // get_chunk binary searches, so runs have to be sorted and can't overlap
+        if (i > 0) {
+            const Bitmask3DRun& last = new_runs[i - 1];
+            bool same_row = last.start.z == run.start.z && last.start.y == run.start.y;
+            if (!chunk_order(last.start, run.start) || (same_row && int64(last.start.x) + last.length > run.start.x))
+                return false;
+        }
+    }
+
+    runs    = new_runs;
+    payload = span<const uint64>((const uint64*) (data.data() + payload_start), header.payload_count);
+    return true;
+}
+
+uint64 Bitmask3DView::get_chunk(v3i chunk_index) const {
+    // last run that starts at or before chunk_index
+    auto it = std::upper_bound(runs.begin(), runs.end(), chunk_index, [](v3i value, const Bitmask3DRun& run) {
+        return chunk_order(value, run.start);
+    });
+    if (it == runs.begin())
+        return 0;
+    const Bitmask3DRun& run = *(it - 1);
+    if (run.start.z != chunk_index.z || run.start.y != chunk_index.y || chunk_index.x >= run.start.x + int32(run.length))
+        return 0;
+    if (run.payload == Bitmask3DBinaryHeader::full_payload)
+        return ~0ull;
+    return payload[run.payload + (chunk_index.x - run.start.x)];
+}
+
+bool Bitmask3DView::get(v3i pos) const {
+    v3i chunk_index = math::floor_cast(v3(pos) / v3(4.0f));
+    v3i local_pos = pos - chunk_index * v3i(4);
+    uint8 bit_index = local_pos.z * 4 * 4 + local_pos.y * 4 + local_pos.x;
+    return get_chunk(chunk_index) & (0b1ull << bit_index);
+}
+
 }
\ No newline at end of file
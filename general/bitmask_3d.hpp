@@ -1,20 +1,113 @@
 ﻿#pragma once
 
 #include "general/umap.hpp"
+#include "general/memory.hpp"
 #include "general/function.hpp"
 #include "general/math/geometry.hpp"
 
 namespace spellbook {
 
+struct Bitmask3DChange {
+    uint64 version;
+    v3i    chunk_index;
+};
+
+// Not carried over by copies, a copy is a different mask as far as listeners are concerned
+struct Bitmask3DListeners {
+    using Callback = std::pair<uint64, function<void(const Bitmask3DChange&)>>;
+
+    vector<Callback> callbacks;
+    // Callbacks can subscribe and unsubscribe. While dispatching, new ones wait here and removed ones get id 0,
+    // the list only changes once the outermost dispatch is done.
+    vector<Callback> added;
+    uint32 dispatch_depth = 0;
+    uint64 next_id = 1;
+
+    Bitmask3DListeners() = default;
+    Bitmask3DListeners(const Bitmask3DListeners&) {}
+    Bitmask3DListeners(Bitmask3DListeners&&) = default;
+    Bitmask3DListeners& operator=(const Bitmask3DListeners&) { return *this; }
+    Bitmask3DListeners& operator=(Bitmask3DListeners&&) = default;
+
+    void dispatch(const Bitmask3DChange& change);
+};
+
 struct Bitmask3D {
-    umap<v3i, uint64> chunks;
+    using ChunkMap = umap<v3i, uint64>;
+
+    // Copies share chunk storage until one of them is written to, so a copy is a cheap immutable snapshot
+    // that other threads can read while the original keeps being edited. Only the owning thread may write.
+    shared_ptr<ChunkMap> chunk_storage = make_shared<ChunkMap>();
+    // Set once the storage is shared, the next write copies it. Checking use_count instead would race with
+    // snapshots released on other threads, nothing orders their last read before the write.
+    mutable bool storage_shared = false;
+    uint64 version = 0;
+
+    // Chunks touched by each write, oldest first. It holds every change after journal_start, older entries
+    // are trimmed past journal_limit and consumers that fell behind that have to rebuild from scratch.
+    vector<Bitmask3DChange> journal;
+    uint64 journal_start = 0;
+    uint32 journal_limit = 4096;
+    Bitmask3DListeners listeners;
+
+    Bitmask3D() = default;
+    Bitmask3D(const Bitmask3D& other);
+    Bitmask3D(Bitmask3D&&) = default;
+    Bitmask3D& operator=(const Bitmask3D& other);
+    Bitmask3D& operator=(Bitmask3D&&) = default;
 
     void set(v3i pos, bool on = true);
     bool get(v3i pos) const;
     v3i rough_min() const;
     v3i rough_max() const;
     void clear();
+
+    const ChunkMap& chunks() const { return *chunk_storage; }
+    // Shares storage but not the journal
+    Bitmask3D snapshot() const;
+
+    // Returns false when the journal no longer reaches back to since_version
+    bool changes_since(uint64 since_version, uset<v3i>& dirty_chunks) const;
+    uint64 subscribe(const function<void(const Bitmask3DChange&)>& callback);
+    void unsubscribe(uint64 id);
+
+    ChunkMap& _mutable_chunks();
+    void _record_change(v3i chunk_index);
+    void _record_reset(const ChunkMap& old_chunks);
 };
 bool ray_intersection(const Bitmask3D& bitmask, ray3 ray, v3& pos, v3i& cube, const function<bool(ray3, v3i, v3&)>& additional_constraints);
 
+// Binary form for AssetFile::binary_blob. Non-empty chunks sorted by z, y, x and grouped into runs along x,
+// runs of completely full chunks store no payload and empty chunks are not stored at all.
+struct Bitmask3DRun {
+    v3i    start;
+    uint32 length;
+    uint32 payload;
+};
+
+struct Bitmask3DBinaryHeader {
+    static constexpr uint32 magic_value = 0x44334d42; // "BM3D"
+    static constexpr uint32 current_version = 1;
+    static constexpr uint32 full_payload = UINT32_MAX;
+
+    uint32 magic;
+    uint32 version;
+    uint32 run_count;
+    uint32 payload_count;
+};
+
+void write_bitmask_binary(const Bitmask3D& bitmask, vector<uint8>& out);
+bool read_bitmask_binary(span<const uint8> data, Bitmask3D& bitmask);
+
+// Queries the binary form in place, data has to outlive the view. load fails unless data is 8 byte aligned and
+// its runs are sorted and don't overlap.
+struct Bitmask3DView {
+    span<const Bitmask3DRun> runs;
+    span<const uint64>       payload;
+
+    bool   load(span<const uint8> data);
+    uint64 get_chunk(v3i chunk_index) const;
+    bool   get(v3i pos) const;
+};
+
 }
\ No newline at end of file
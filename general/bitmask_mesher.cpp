@@ -0,0 +1,257 @@
+#include "bitmask_mesher.hpp"
+
+#include <array>
+#include <bit>
+
+#include "general/math/math.hpp"
+
+namespace spellbook {
+
+constexpr int32 chunk_size  = Bitmask3DMesher::chunk_size;
+constexpr int32 padded_size = chunk_size + 2;
+
+// The chunk plus a one voxel border, so faces on the chunk boundary can see their neighbors
+struct ChunkOccupancy {
+    std::array<uint8, padded_size * padded_size * padded_size> solid;
+
+    uint8 get(v3i local) const {
+        return solid[((local.z + 1) * padded_size + local.y + 1) * padded_size + local.x + 1];
+    }
+    void set(v3i local) {
+        solid[((local.z + 1) * padded_size + local.y + 1) * padded_size + local.x + 1] = 1;
+    }
+};
+
+v3i mesh_chunk_id(v3i voxel) {
+    return math::floor_cast(v3(voxel) / v3(float(chunk_size)));
+}
+
+// Returns whether any voxel inside the chunk itself is solid
+static bool load_occupancy(const Bitmask3D& bitmask, v3i origin, ChunkOccupancy& occupancy) {
+    occupancy.solid.fill(0);
+    bool any_inside = false;
+
+    v3i bitmask_min = math::floor_cast(v3(origin - v3i(1)) / v3(4.0f));
+    v3i bitmask_max = math::floor_cast(v3(origin + v3i(chunk_size)) / v3(4.0f));
+    v3i bitmask_id  = bitmask_min;
+    const Bitmask3D::ChunkMap& chunks = bitmask.chunks();
+    do {
+        auto it = chunks.find(bitmask_id);
+        if (it == chunks.end())
+            continue;
+        uint64 bits = it->second;
+        while (bits) {
+            int32 bit = std::countr_zero(bits);
+            bits &= bits - 1;
+            v3i local = bitmask_id * 4 + v3i(bit & 3, (bit >> 2) & 3, bit >> 4) - origin;
+            if (local.x < -1 || local.y < -1 || local.z < -1 || local.x > chunk_size || local.y > chunk_size || local.z > chunk_size)
+                continue;
+            occupancy.set(local);
+            any_inside |= local.x >= 0 && local.y >= 0 && local.z >= 0 && local.x < chunk_size && local.y < chunk_size && local.z < chunk_size;
+        }
+    } while (math::iterate(bitmask_id, bitmask_min, bitmask_max));
+
+    return any_inside;
+}
+
+// Per axis and facing, sweeps slices of the chunk and merges visible faces into maximal rectangles
+static void emit_quads(const ChunkOccupancy& occupancy, v3i origin, BitmaskMeshChunk& chunk) {
+    std::array<uint8, chunk_size * chunk_size> mask;
+    for (int32 axis = 0; axis < 3; axis++) {
+        int32 u = (axis + 1) % 3;
+        int32 v = (axis + 2) % 3;
+        for (int32 facing : {1, -1}) {
+            for (int32 slice = 0; slice < chunk_size; slice++) {
+                for (int32 j = 0; j < chunk_size; j++) {
+                    for (int32 i = 0; i < chunk_size; i++) {
+                        v3i pos;
+                        pos[axis] = slice;
+                        pos[u] = i;
+                        pos[v] = j;
+                        v3i neighbor = pos;
+                        neighbor[axis] += facing;
+                        mask[j * chunk_size + i] = occupancy.get(pos) && !occupancy.get(neighbor);
+                    }
+                }
+
+                for (int32 j = 0; j < chunk_size; j++) {
+                    for (int32 i = 0; i < chunk_size;) {
+                        if (!mask[j * chunk_size + i]) {
+                            i++;
+                            continue;
+                        }
+
+                        int32 width = 1;
+                        while (i + width < chunk_size && mask[j * chunk_size + i + width])
+                            width++;
+                        int32 height = 1;
+                        while (j + height < chunk_size) {
+                            bool full_row = true;
+                            for (int32 k = 0; k < width && full_row; k++)
+                                full_row = mask[(j + height) * chunk_size + i + k];
+                            if (!full_row)
+                                break;
+                            height++;
+                        }
+                        for (int32 dj = 0; dj < height; dj++)
+                            for (int32 di = 0; di < width; di++)
+                                mask[(j + dj) * chunk_size + i + di] = 0;
+
+                        v3 base;
+                        base[axis] = float(origin[axis] + slice + (facing > 0 ? 1 : 0));
+                        base[u] = float(origin[u] + i);
+                        base[v] = float(origin[v] + j);
+                        v3 du = v3(0.0f);
+                        du[u] = float(width);
+                        v3 dv = v3(0.0f);
+                        dv[v] = float(height);
+                        v3 normal = v3(0.0f);
+                        normal[axis] = float(facing);
+
+                        // u x v is +axis, so this winding is counter clockwise seen from the facing side
+                        uint32 first = chunk.positions.size();
+                        chunk.positions.push_back(base);
+                        chunk.positions.push_back(base + du);
+                        chunk.positions.push_back(base + du + dv);
+                        chunk.positions.push_back(base + dv);
+                        for (int32 n = 0; n < 4; n++)
+                            chunk.normals.push_back(normal);
+                        if (facing > 0) {
+                            for (uint32 index : {0, 1, 2, 0, 2, 3})
+                                chunk.indices.push_back(first + index);
+                        } else {
+                            for (uint32 index : {0, 2, 1, 0, 3, 2})
+                                chunk.indices.push_back(first + index);
+                        }
+
+                        i += width;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Grows boxes along x, then y, then z from the first unclaimed solid voxel
+static void emit_boxes(const ChunkOccupancy& occupancy, v3i origin, BitmaskMeshChunk& chunk) {
+    std::array<uint8, chunk_size * chunk_size * chunk_size> claimed = {};
+    auto open = [&](int32 x, int32 y, int32 z) {
+        return occupancy.get(v3i(x, y, z)) && !claimed[(z * chunk_size + y) * chunk_size + x];
+    };
+
+    for (int32 z = 0; z < chunk_size; z++) {
+        for (int32 y = 0; y < chunk_size; y++) {
+            for (int32 x = 0; x < chunk_size; x++) {
+                if (!open(x, y, z))
+                    continue;
+
+                int32 width = 1;
+                while (x + width < chunk_size && open(x + width, y, z))
+                    width++;
+
+                int32 height = 1;
+                for (bool full = true; full && y + height < chunk_size; ) {
+                    for (int32 i = 0; i < width && full; i++)
+                        full = open(x + i, y + height, z);
+                    if (full)
+                        height++;
+                }
+
+                int32 depth = 1;
+                for (bool full = true; full && z + depth < chunk_size; ) {
+                    for (int32 j = 0; j < height && full; j++)
+                        for (int32 i = 0; i < width && full; i++)
+                            full = open(x + i, y + j, z + depth);
+                    if (full)
+                        depth++;
+                }
+
+                for (int32 k = 0; k < depth; k++)
+                    for (int32 j = 0; j < height; j++)
+                        for (int32 i = 0; i < width; i++)
+                            claimed[((z + k) * chunk_size + y + j) * chunk_size + x + i] = 1;
+
+                v3i box_min = origin + v3i(x, y, z);
+                chunk.boxes.push_back(range3(v3(box_min), v3(box_min + v3i(width, height, depth))));
+            }
+        }
+    }
+}
+
+void Bitmask3DMesher::rebuild_chunk(const Bitmask3D& bitmask, v3i chunk_id) {
+    ChunkOccupancy occupancy;
+    v3i  origin = chunk_id * chunk_size;
+    bool any    = load_occupancy(bitmask, origin, occupancy);
+    if (!any && !chunks.contains(chunk_id))
+        return;
+
+    BitmaskMeshChunk& chunk = chunks[chunk_id];
+    chunk.chunk_id = chunk_id;
+    chunk.revision++;
+    chunk.positions.clear();
+    chunk.normals.clear();
+    chunk.indices.clear();
+    chunk.boxes.clear();
+    if (!any)
+        return;
+
+    if (build_mesh)
+        emit_quads(occupancy, origin, chunk);
+    if (build_boxes)
+        emit_boxes(occupancy, origin, chunk);
+}
+
+void Bitmask3DMesher::rebuild_region(const Bitmask3D& bitmask, v3i min, v3i max) {
+    v3i chunk_min = mesh_chunk_id(min - v3i(1));
+    v3i chunk_max = mesh_chunk_id(max + v3i(1));
+    v3i chunk_id  = chunk_min;
+    do {
+        rebuild_chunk(bitmask, chunk_id);
+    } while (math::iterate(chunk_id, chunk_min, chunk_max));
+}
+
+void Bitmask3DMesher::rebuild(const Bitmask3D& bitmask) {
+    built_version = bitmask.version;
+    uset<v3i> chunk_ids;
+    for (auto& [chunk_id, _] : chunks)
+        chunk_ids.insert(chunk_id);
+    for (auto& [bitmask_id, bits] : bitmask.chunks()) {
+        if (bits != 0)
+            chunk_ids.insert(mesh_chunk_id(bitmask_id * 4));
+    }
+    for (v3i chunk_id : chunk_ids)
+        rebuild_chunk(bitmask, chunk_id);
+}
+
+void Bitmask3DMesher::update(const Bitmask3D& bitmask) {
+    if (bitmask.version == built_version)
+        return;
+
+    uset<v3i> dirty_chunks;
+    if (!bitmask.changes_since(built_version, dirty_chunks)) {
+        rebuild(bitmask);
+        return;
+    }
+
+    uset<v3i> chunk_ids;
+    for (v3i bitmask_id : dirty_chunks) {
+        v3i chunk_min = mesh_chunk_id(bitmask_id * 4 - v3i(1));
+        v3i chunk_max = mesh_chunk_id(bitmask_id * 4 + v3i(4));
+        v3i chunk_id  = chunk_min;
+        do {
+            chunk_ids.insert(chunk_id);
+        } while (math::iterate(chunk_id, chunk_min, chunk_max));
+    }
+    for (v3i chunk_id : chunk_ids)
+        rebuild_chunk(bitmask, chunk_id);
+    built_version = bitmask.version;
+}
+
+uint32 Bitmask3DMesher::triangle_count() const {
+    uint32 count = 0;
+    for (auto& [_, chunk] : chunks)
+        count += chunk.indices.size() / 3;
+    return count;
+}
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "general/umap.hpp"
+#include "general/vector.hpp"
+#include "general/bitmask_3d.hpp"
+
+namespace spellbook {
+
+// Merged surface and collision geometry for one chunk_size^3 block of a Bitmask3D.
+// Buffers are cleared rather than freed between rebuilds, revision bumps whenever they are rewritten.
+struct BitmaskMeshChunk {
+    v3i chunk_id;
+    uint64 revision = 0;
+
+    vector<v3>     positions;
+    vector<v3>     normals;
+    vector<uint32> indices;
+    vector<range3> boxes;
+};
+
+struct Bitmask3DMesher {
+    static constexpr int32 chunk_size = 16;
+
+    bool build_mesh  = true;
+    bool build_boxes = true;
+    uint64 built_version = 0;
+    umap<v3i, BitmaskMeshChunk> chunks;
+
+    void rebuild(const Bitmask3D& bitmask);
+    // Rebuilds the chunks around the edits recorded in the mask's journal since the last build
+    void update(const Bitmask3D& bitmask);
+    // Voxel space bounds of an edit, neighboring chunks are included when the edit touches their faces
+    void rebuild_region(const Bitmask3D& bitmask, v3i min, v3i max);
+    void rebuild_chunk(const Bitmask3D& bitmask, v3i chunk_id);
+
+    uint32 triangle_count() const;
+};
+
+v3i mesh_chunk_id(v3i voxel);
+
+}
@@ -0,0 +1,211 @@
+#include "distance_field_3d.hpp"
+
+#include <bit>
+
+#include "general/math/math.hpp"
+
+namespace spellbook {
+
+constexpr float edt_infinity = 1e20f;
+// Past this many dirty chunks the overlapping local updates cost more than a full bake
+constexpr uint32 max_incremental_chunks = 64;
+
+// Felzenszwalb & Huttenlocher, squared distance transform of one line of the grid in place.
+// Infinite samples are skipped, their parabolas can never be part of the lower envelope.
+static void edt_line(float* f, int32 n, int32 stride, vector<float>& line, vector<int32>& v, vector<float>& z) {
+    for (int32 q = 0; q < n; q++)
+        line[q] = f[q * stride];
+
+    int32 k = -1;
+    for (int32 q = 0; q < n; q++) {
+        if (line[q] >= edt_infinity)
+            continue;
+        float s = -edt_infinity;
+        while (k >= 0) {
+            int32 p = v[k];
+            s = ((line[q] + float(q * q)) - (line[p] + float(p * p))) / float(2 * q - 2 * p);
+            if (s > z[k])
+                break;
+            k--;
+        }
+        k++;
+        v[k]     = q;
+        z[k]     = k == 0 ? -edt_infinity : s;
+        z[k + 1] = edt_infinity;
+    }
+    if (k < 0)
+        return;
+
+    k = 0;
+    for (int32 q = 0; q < n; q++) {
+        while (z[k + 1] < float(q))
+            k++;
+        float d = float(q - v[k]);
+        f[q * stride] = d * d + line[v[k]];
+    }
+}
+
+static void edt_grid(vector<float>& grid, v3i size) {
+    int32 longest = math::max(size.x, size.y, size.z);
+    vector<float> line(longest, 0.0f);
+    vector<int32> v(longest, 0);
+    vector<float> z(longest + 1, 0.0f);
+
+    for (int32 z_i = 0; z_i < size.z; z_i++)
+        for (int32 y_i = 0; y_i < size.y; y_i++)
+            edt_line(&grid[(z_i * size.y + y_i) * size.x], size.x, 1, line, v, z);
+    for (int32 z_i = 0; z_i < size.z; z_i++)
+        for (int32 x_i = 0; x_i < size.x; x_i++)
+            edt_line(&grid[z_i * size.y * size.x + x_i], size.y, size.x, line, v, z);
+    for (int32 y_i = 0; y_i < size.y; y_i++)
+        for (int32 x_i = 0; x_i < size.x; x_i++)
+            edt_line(&grid[y_i * size.x + x_i], size.z, size.x * size.y, line, v, z);
+}
+
+static void fill_chunk(uint64 bits, v3i chunk_id, v3i region_min, v3i region_size, vector<float>& grid) {
+    v3i origin = chunk_id * 4;
+    while (bits) {
+        int32 bit = std::countr_zero(bits);
+        bits &= bits - 1;
+        v3i local = origin + v3i(bit & 3, (bit >> 2) & 3, bit >> 4) - region_min;
+        if (local.x < 0 || local.y < 0 || local.z < 0 || local.x >= region_size.x || local.y >= region_size.y || local.z >= region_size.z)
+            continue;
+        grid[(local.z * region_size.y + local.y) * region_size.x + local.x] = 0.0f;
+    }
+}
+
+// Solids become 0, everything else infinity
+static void fill_solids(const Bitmask3D& bitmask, v3i region_min, v3i region_size, vector<float>& grid) {
+    grid.clear();
+    grid.resize(region_size.x * region_size.y * region_size.z, edt_infinity);
+
+    v3i chunk_min = math::floor_cast(v3(region_min) / v3(4.0f));
+    v3i chunk_max = math::floor_cast(v3(region_min + region_size - v3i(1)) / v3(4.0f));
+    v3i chunk_span = chunk_max - chunk_min + v3i(1);
+
+    // Small regions look up their chunks, big ones walk the map
+    const Bitmask3D::ChunkMap& chunks = bitmask.chunks();
+    if (uint64(chunk_span.x) * chunk_span.y * chunk_span.z < chunks.size()) {
+        v3i chunk_id = chunk_min;
+        do {
+            if (chunks.contains(chunk_id))
+                fill_chunk(chunks.at(chunk_id), chunk_id, region_min, region_size, grid);
+        } while (math::iterate(chunk_id, chunk_min, chunk_max));
+    } else {
+        for (auto& [chunk_id, bits] : chunks) {
+            if (chunk_id.x < chunk_min.x || chunk_id.y < chunk_min.y || chunk_id.z < chunk_min.z ||
+                chunk_id.x > chunk_max.x || chunk_id.y > chunk_max.y || chunk_id.z > chunk_max.z)
+                continue;
+            fill_chunk(bits, chunk_id, region_min, region_size, grid);
+        }
+    }
+}
+
+static uint8 quantize_distance(float distance_squared, int32 max_distance) {
+    float distance = math::min(math::sqrt(distance_squared), float(max_distance));
+    return uint8(distance * DistanceField3D::steps_per_voxel + 0.5f);
+}
+
+void DistanceField3D::bake(const Bitmask3D& bitmask, int32 new_max_distance) {
+    max_distance  = math::clamp(new_max_distance, 1, max_max_distance);
+    baked_version = bitmask.version;
+    distances.clear();
+
+    v3i solid_min = bitmask.rough_min();
+    v3i solid_max = bitmask.rough_max();
+    if (solid_min.x > solid_max.x) {
+        min  = v3i(0);
+        size = v3i(0);
+        return;
+    }
+
+    min  = solid_min - v3i(max_distance);
+    size = solid_max + v3i(max_distance) - min + v3i(1);
+
+    vector<float> grid;
+    fill_solids(bitmask, min, size, grid);
+    edt_grid(grid, size);
+
+    distances.resize(grid.size());
+    for (uint32 i = 0; i < grid.size(); i++)
+        distances[i] = quantize_distance(grid[i], max_distance);
+}
+
+void DistanceField3D::update(const Bitmask3D& bitmask) {
+    if (bitmask.version == baked_version)
+        return;
+
+    uset<v3i> dirty_chunks;
+    if (!bitmask.changes_since(baked_version, dirty_chunks) || dirty_chunks.size() > max_incremental_chunks) {
+        bake(bitmask, max_distance);
+        return;
+    }
+    for (v3i chunk_index : dirty_chunks) {
+        update(bitmask, chunk_index * 4, chunk_index * 4 + v3i(3));
+        if (baked_version == bitmask.version)
+            return; // fell back to a full bake
+    }
+    baked_version = bitmask.version;
+}
+
+void DistanceField3D::update(const Bitmask3D& bitmask, v3i edit_min, v3i edit_max) {
+    v3i write_min = edit_min - v3i(max_distance);
+    v3i write_max = edit_max + v3i(max_distance);
+    if (!contains(write_min) || !contains(write_max)) {
+        bake(bitmask, max_distance);
+        return;
+    }
+
+    // Only solids within max_distance of the written voxels can affect them
+    v3i read_min  = write_min - v3i(max_distance);
+    v3i read_size = write_max + v3i(max_distance) - read_min + v3i(1);
+
+    vector<float> grid;
+    fill_solids(bitmask, read_min, read_size, grid);
+    edt_grid(grid, read_size);
+
+    v3i pos = write_min;
+    do {
+        v3i read_local  = pos - read_min;
+        v3i write_local = pos - min;
+        float distance_squared = grid[(read_local.z * read_size.y + read_local.y) * read_size.x + read_local.x];
+        distances[(write_local.z * size.y + write_local.y) * size.x + write_local.x] = quantize_distance(distance_squared, max_distance);
+    } while (math::iterate(pos, write_min, write_max));
+}
+
+bool DistanceField3D::contains(v3i pos) const {
+    v3i local = pos - min;
+    return local.x >= 0 && local.y >= 0 && local.z >= 0 && local.x < size.x && local.y < size.y && local.z < size.z;
+}
+
+float DistanceField3D::get(v3i pos) const {
+    if (!contains(pos))
+        return float(max_distance);
+    v3i local = pos - min;
+    return float(distances[(local.z * size.y + local.y) * size.x + local.x]) / float(steps_per_voxel);
+}
+
+float DistanceField3D::sample(v3 pos) const {
+    v3  p    = pos - v3(0.5f);
+    v3i base = math::floor_cast(p);
+    v3  t    = p - v3(base);
+
+    float x00 = math::mix(get(base + v3i(0, 0, 0)), get(base + v3i(1, 0, 0)), t.x);
+    float x10 = math::mix(get(base + v3i(0, 1, 0)), get(base + v3i(1, 1, 0)), t.x);
+    float x01 = math::mix(get(base + v3i(0, 0, 1)), get(base + v3i(1, 0, 1)), t.x);
+    float x11 = math::mix(get(base + v3i(0, 1, 1)), get(base + v3i(1, 1, 1)), t.x);
+    float y0  = math::mix(x00, x10, t.y);
+    float y1  = math::mix(x01, x11, t.y);
+    return math::mix(y0, y1, t.z);
+}
+
+v3 DistanceField3D::gradient(v3 pos) const {
+    constexpr float h = 0.5f;
+    return v3(
+        sample(pos + v3(h, 0.0f, 0.0f)) - sample(pos - v3(h, 0.0f, 0.0f)),
+        sample(pos + v3(0.0f, h, 0.0f)) - sample(pos - v3(0.0f, h, 0.0f)),
+        sample(pos + v3(0.0f, 0.0f, h)) - sample(pos - v3(0.0f, 0.0f, h))
+    ) / (2.0f * h);
+}
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "general/vector.hpp"
+#include "general/bitmask_3d.hpp"
+
+namespace spellbook {
+
+// Euclidean distance from each voxel center to the nearest solid voxel center of a Bitmask3D.
+// Distances are quantized to 1/steps_per_voxel and saturate at max_distance, anything outside the baked
+// region is at least max_distance away from all solids.
+struct DistanceField3D {
+    static constexpr int32 steps_per_voxel = 8;
+    static constexpr int32 max_max_distance = 255 / steps_per_voxel;
+
+    v3i   min          = v3i(0);
+    v3i   size         = v3i(0);
+    int32 max_distance = 8;
+    uint64 baked_version = 0;
+    vector<uint8> distances;
+
+    void bake(const Bitmask3D& bitmask, int32 max_distance = 8);
+    // Catches up with the edits recorded in the mask's journal since the last bake
+    void update(const Bitmask3D& bitmask);
+    // Rebakes only the voxels that an edit inside [edit_min, edit_max] can influence
+    void update(const Bitmask3D& bitmask, v3i edit_min, v3i edit_max);
+
+    bool  contains(v3i pos) const;
+    float get(v3i pos) const;
+    // Trilinear, pos is in world voxel space where voxel v spans [v, v + 1)
+    float sample(v3 pos) const;
+    v3    gradient(v3 pos) const;
+};
+
+}
@@ -1,8 +1,10 @@
 #include "asset_loader.hpp"
 
+#include <cstring>
 #include <fstream>
 
 #include "general/logger.hpp"
+#include "general/file/file_view.hpp"
 
 namespace spellbook {
 
@@ -31,31 +33,32 @@ void save_asset_file(const AssetFile& asset_file) {
 }
 
 AssetFile load_asset_file(const FilePath& file_path) {
-    string                ext = file_path.extension();
-    
-    std::ifstream infile;
-    infile.open(file_path.abs_string(), std::ios::binary);
-
-    assert_else(infile.is_open())
+    FileView file(file_path.abs_string());
+    bool opened = file.opened;
+    assert_else(opened)
         return {};
 
     AssetFile asset_file;
-    string    json_string;
 
+    // type (legacy), version, json length, blob length
+    constexpr uint64 header_size = 4 * sizeof(uint32);
     uint32 json_length = 0;
     uint32 blob_length = 0;
+    bool has_header = file.size >= header_size;
+    check_else(has_header)
+        return {};
+    memcpy(&asset_file.version, file.data + 4, sizeof(uint32));
+    memcpy(&json_length, file.data + 8, sizeof(uint32));
+    memcpy(&blob_length, file.data + 12, sizeof(uint32));
+    bool has_contents = header_size + json_length + blob_length <= file.size;
+    check_else(has_contents)
+        return {};
 
-    array<char, 4> type;
-    infile.read(type.data(), 4);
-    infile.read((char*) &asset_file.version, sizeof(uint32));
-    infile.read((char*) &json_length, sizeof(uint32));
-    infile.read((char*) &blob_length, sizeof(uint32));
-    json_string.resize(json_length);
+    // the json is parsed straight out of the mapping, only the blob that the caller keeps is copied
+    asset_file.asset_json = parse(file.view().substr(header_size, json_length));
     asset_file.binary_blob.resize(blob_length);
-    infile.read(json_string.data(), json_length);
-    infile.read((char*) asset_file.binary_blob.data(), blob_length);
-
-    asset_file.asset_json = parse(json_string);
+    if (blob_length > 0)
+        memcpy(asset_file.binary_blob.data(), file.data + header_size + json_length, blob_length);
 
     return asset_file;
 }
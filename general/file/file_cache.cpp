@@ -1,7 +1,13 @@
 #include "file_cache.hpp"
 
+#include <algorithm>
+#include <condition_variable>
+
 #include "extension/fmt.hpp"
 #include "general/logger.hpp"
+#include "general/thread_pool.hpp"
+#include "general/file/parse_cache.hpp"
+#include "general/file/resource.hpp"
 
 namespace spellbook {
 
@@ -12,30 +18,561 @@ FileCache& get_file_cache() {
     return file_cache;
 }
 
-json& FileCache::load_json(const FilePath& file_path) {
-    if (parsed_jsons.contains(file_path))
-        return parsed_jsons[file_path];
+static uint64 memory_usage(const json& j) {
+    return sizeof(json) + json_memory_usage(j);
+}
 
-    if (print_file_load_info)
-        log(BasicMessage{.str=fmt_("Loading json: {}", file_path.abs_string()), .group = "asset"});
-    parsed_jsons[file_path] = parse_file(file_path.abs_string());
-    load_dependencies(parsed_jsons[file_path]);
-    return parsed_jsons[file_path];
+static uint64 memory_usage(const AssetFile& asset_file) {
+    return sizeof(AssetFile) + asset_file.binary_blob.internal.capacity() + json_memory_usage(asset_file.asset_json);
+}
+
+// members parsed after it's stored aren't counted, they're shared with the json once it's loaded anyway
+static uint64 memory_usage(const lazy_json& lazy) {
+    return sizeof(lazy_json) + lazy.source.size() + lazy.members.size() * (sizeof(umap<json_key, lazy_json::member>::value_type) + sizeof(void*) + 1);
+}
+
+template <typename T>
+static uint64& bytes_stat(FileCacheStats& stats) {
+    if constexpr (std::is_same_v<T, json>)
+        return stats.json_bytes;
+    else if constexpr (std::is_same_v<T, lazy_json>)
+        return stats.lazy_bytes;
+    else
+        return stats.asset_bytes;
+}
+
+// The json and asset files named in a json's dependency list. Runs under the cache lock, so anything that isn't a
+// path is skipped rather than thrown on.
+static vector<FilePath> find_dependencies(const json& j) {
+    vector<FilePath> dependencies;
+    if (auto it = j.find("dependencies"); it != j.end()) {
+        if (!std::holds_alternative<vector<json_value>>(it->second->value)) {
+            log_warning("Skipped dependencies that aren't a list", "file");
+            return dependencies;
+        }
+        for (const json_value& jv : it->second->get_elements()) {
+            if (!std::holds_alternative<string>(jv.value)) {
+                log_warning(fmt_("Skipped dependency that isn't a path: {}", jv.dump()), "file");
+                continue;
+            }
+            FilePath dependency = from_jv<FilePath>(jv);
+            string extension = dependency.extension();
+            if (extension.starts_with(".sba") || extension.starts_with(".sbj"))
+                dependencies.push_back(std::move(dependency));
+        }
+    }
+    return dependencies;
+}
+
+template <typename T>
+void FileCache::_touch(FileCacheEntry<T>& entry) {
+    // lookups only hold the shared lock
+    std::atomic_ref(entry.last_used).store(++use_clock, std::memory_order_relaxed);
+}
+
+template <typename T>
+FileCacheClaim<T> FileCache::_claim(umap<FilePath, FileCacheEntry<T>>& parsed, umap<FilePath, FileCachePending<T>>& pending, const FilePath& file_path) {
+    FileCacheClaim<T> claim;
+    {
+        std::shared_lock lock(mutex);
+        if (auto it = parsed.find(file_path); it != parsed.end()) {
+            _touch(it->second);
+            claim.loaded = it->second.value;
+            return claim;
+        }
+        if (auto it = pending.find(file_path); it != pending.end()) {
+            claim.future = it->second.future;
+            return claim;
+        }
+    }
+
+    std::unique_lock lock(mutex);
+    // someone may have gotten here between the locks
+    if (auto it = parsed.find(file_path); it != parsed.end()) {
+        _touch(it->second);
+        claim.loaded = it->second.value;
+    } else if (auto pending_it = pending.find(file_path); pending_it != pending.end()) {
+        claim.future = pending_it->second.future;
+    } else {
+        claim.promise = make_shared<std::promise<FileCachePin<T>>>();
+        claim.future = claim.promise->get_future().share();
+        pending.emplace(file_path, FileCachePending<T>{claim.future, claim.promise});
+    }
+    return claim;
+}
+
+template <typename T>
+FileCachePin<T> FileCache::_fulfill(umap<FilePath, FileCacheEntry<T>>& parsed, umap<FilePath, FileCachePending<T>>& pending, const FilePath& file_path, T&& value, std::promise<FileCachePin<T>>& promise) {
+    uint64 bytes = memory_usage(value);
+    FileCachePin<T> pin = make_shared<T>(std::move(value));
+    vector<shared_ptr<const void>> released;
+    {
+        std::unique_lock lock(mutex);
+        // invalidated while it was read, what it read may already be stale
+        if (auto it = pending.find(file_path); it != pending.end() && it->second.promise.get() == &promise) {
+            _store(parsed, file_path, pin, bytes);
+            pending.erase(it);
+            released = _evict();
+        }
+    }
+    promise.set_value(pin);
+    return pin;
+}
+
+template <typename T>
+void FileCache::_fail(umap<FilePath, FileCachePending<T>>& pending, const FilePath& file_path, std::promise<FileCachePin<T>>& promise, std::exception_ptr error) {
+    {
+        std::unique_lock lock(mutex);
+        if (auto it = pending.find(file_path); it != pending.end() && it->second.promise.get() == &promise)
+            pending.erase(it);
+    }
+    promise.set_exception(error);
+}
+
+template <typename T>
+void FileCache::_store(umap<FilePath, FileCacheEntry<T>>& parsed, const FilePath& file_path, const FileCachePin<T>& pin, uint64 bytes) {
+    FileCacheEntry<T>& entry = parsed[file_path];
+    if (entry.value)
+        bytes_stat<T>(stats) -= entry.bytes;
+    entry.value = pin;
+    entry.bytes = bytes;
+    entry.last_used = ++use_clock;
+    bytes_stat<T>(stats) += bytes;
+    if constexpr (std::is_same_v<T, json>)
+        dependency_edges[file_path] = find_dependencies(*pin);
+
+    stats.loads++;
+    if (evicted.erase(file_path) > 0)
+        stats.reloads++;
+}
+
+vector<shared_ptr<const void>> FileCache::_evict() {
+    vector<shared_ptr<const void>> released;
+    if (memory_budget == 0 || stats.total_bytes() <= memory_budget)
+        return released;
+
+    struct candidate {
+        uint64 last_used;
+        FilePath file_path;
+        uint32 map;
+    };
+    vector<candidate> candidates;
+    // the map's reference is the only one, so nobody has it pinned
+    for (auto& [file_path, entry] : parsed_jsons) {
+        if (entry.value.use_count() == 1)
+            candidates.push_back({entry.last_used, file_path, 0});
+    }
+    for (auto& [file_path, entry] : lazy_jsons) {
+        if (entry.value.use_count() == 1)
+            candidates.push_back({entry.last_used, file_path, 1});
+    }
+    for (auto& [file_path, entry] : parsed_assets) {
+        if (entry.value.use_count() == 1)
+            candidates.push_back({entry.last_used, file_path, 2});
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const candidate& a, const candidate& b) { return a.last_used < b.last_used; });
+
+    auto evict_from = [this, &released](auto& parsed, const FilePath& file_path) {
+        auto it = parsed.find(file_path);
+        using T = typename std::decay_t<decltype(it->second.value)>::element_type;
+        bytes_stat<T>(stats) -= it->second.bytes;
+        stats.evictions++;
+        stats.evicted_bytes += it->second.bytes;
+        released.push_back(std::move(it->second.value));
+        parsed.erase(it);
+    };
+    for (const candidate& c : candidates) {
+        if (stats.total_bytes() <= memory_budget)
+            break;
+        if (c.map == 0)
+            evict_from(parsed_jsons, c.file_path);
+        else if (c.map == 1)
+            evict_from(lazy_jsons, c.file_path);
+        else
+            evict_from(parsed_assets, c.file_path);
+        evicted.insert(c.file_path);
+    }
+    return released;
+}
+
+void FileCache::set_memory_budget(uint64 bytes) {
+    vector<shared_ptr<const void>> released;
+    std::unique_lock lock(mutex);
+    memory_budget = bytes;
+    released = _evict();
+}
+
+bool FileCache::invalidate(const FilePath& file_path) {
+    vector<shared_ptr<const void>> released;
+    std::unique_lock lock(mutex);
+    auto drop = [this, &released, &file_path](auto& parsed) {
+        auto it = parsed.find(file_path);
+        if (it == parsed.end())
+            return false;
+        using T = typename std::decay_t<decltype(it->second.value)>::element_type;
+        bytes_stat<T>(stats) -= it->second.bytes;
+        released.push_back(std::move(it->second.value));
+        parsed.erase(it);
+        return true;
+    };
+    bool cached = drop(parsed_jsons);
+    cached |= drop(lazy_jsons);
+    cached |= drop(parsed_assets);
+    // a load in flight may have read the old content, the next request starts a fresh one
+    cached |= pending_jsons.erase(file_path) > 0;
+    cached |= pending_assets.erase(file_path) > 0;
+    // not a budget miss when it's loaded again
+    evicted.erase(file_path);
+    return cached;
+}
+
+vector<FilePath> FileCache::find_dependents(const FilePath& file_path) const {
+    std::shared_lock lock(mutex);
+    umap<FilePath, vector<FilePath>> reverse;
+    for (const auto& [dependent, dependencies] : dependency_edges) {
+        for (const FilePath& dependency : dependencies)
+            reverse[dependency].push_back(dependent);
+    }
+
+    vector<FilePath> dependents;
+    uset<FilePath> seen = {file_path};
+    vector<FilePath> frontier = {file_path};
+    while (!frontier.empty()) {
+        vector<FilePath> next;
+        for (const FilePath& at : frontier) {
+            auto it = reverse.find(at);
+            if (it == reverse.end())
+                continue;
+            for (const FilePath& dependent : it->second) {
+                if (seen.insert(dependent).second) {
+                    dependents.push_back(dependent);
+                    next.push_back(dependent);
+                }
+            }
+        }
+        frontier = std::move(next);
+    }
+    return dependents;
+}
+
+FileCacheStats FileCache::get_stats() const {
+    std::shared_lock lock(mutex);
+    return stats;
+}
+
+json FileCache::_read_json(const FilePath& file_path) {
+    FileCachePin<lazy_json> lazy;
+    {
+        std::unique_lock lock(mutex);
+        if (auto it = lazy_jsons.find(file_path); it != lazy_jsons.end()) {
+            // every member ends up shared with the json, so the lazy entry's memory moves over to it
+            lazy = std::move(it->second.value);
+            stats.lazy_bytes -= it->second.bytes;
+            lazy_jsons.erase(it);
+        }
+    }
+    if (!lazy) {
+        if (print_file_load_info)
+            log(BasicMessage{.str=fmt_("Loading json: {}", file_path.abs_string()), .group = "asset"});
+        return get_parse_cache().load(file_path);
+    }
+
+    std::lock_guard lazy_lock(lazy_mutex);
+    return lazy->materialize();
+}
+
+FileCachePin<json> FileCache::load_json(const FilePath& file_path) {
+    FileCacheClaim<json> claim = _claim(parsed_jsons, pending_jsons, file_path);
+    if (claim.loaded)
+        return claim.loaded;
+    if (!claim.promise)
+        return claim.future.get();
+
+    FileCachePin<json> j;
+    try {
+        j = _fulfill(parsed_jsons, pending_jsons, file_path, _read_json(file_path), *claim.promise);
+    } catch (...) {
+        // whoever was waiting on it gets the same exception
+        _fail(pending_jsons, file_path, *claim.promise, std::current_exception());
+        throw;
+    }
+    load_dependencies(*j);
+    return j;
+}
+
+std::shared_future<FileCachePin<json>> FileCache::load_json_async(const FilePath& file_path) {
+    FileCacheClaim<json> claim = _claim(parsed_jsons, pending_jsons, file_path);
+    if (claim.loaded) {
+        std::promise<FileCachePin<json>> ready;
+        ready.set_value(claim.loaded);
+        return ready.get_future().share();
+    }
+    if (claim.promise) {
+        get_thread_pool().enqueue([this, file_path, promise = claim.promise] {
+            // an exception escaping a pool job terminates, it's handed to the future instead
+            FileCachePin<json> j;
+            try {
+                j = _fulfill(parsed_jsons, pending_jsons, file_path, _read_json(file_path), *promise);
+            } catch (...) {
+                _fail(pending_jsons, file_path, *promise, std::current_exception());
+                return;
+            }
+            _load_dependencies_async(*j);
+        });
+    }
+    return claim.future;
+}
+
+void FileCache::load_jsons(const vector<FilePath>& file_paths) {
+    // Workers only ever touch their own slot
+    struct pending_load {
+        FilePath file_path;
+        bool     asset = false;
+        shared_ptr<std::promise<FileCachePin<json>>>      json_promise;
+        shared_ptr<std::promise<FileCachePin<AssetFile>>> asset_promise;
+        json      j;
+        AssetFile asset_file;
+        std::exception_ptr error;
+    };
+
+    uset<FilePath> seen;
+    // loads other threads already had in flight, waited on at the end
+    vector<std::shared_future<FileCachePin<json>>> elsewhere;
+    vector<FilePath> wave = file_paths;
+    while (!wave.empty()) {
+        vector<pending_load> pending;
+        for (const FilePath& file_path : wave) {
+            if (!seen.insert(file_path).second)
+                continue;
+            if (file_path.extension().starts_with(".sba")) {
+                FileCacheClaim<AssetFile> claim = _claim(parsed_assets, pending_assets, file_path);
+                if (claim.promise)
+                    pending.push_back({.file_path = file_path, .asset = true, .asset_promise = claim.promise});
+                continue;
+            }
+            FileCacheClaim<json> claim = _claim(parsed_jsons, pending_jsons, file_path);
+            if (claim.promise)
+                pending.push_back({.file_path = file_path, .json_promise = claim.promise});
+            else if (!claim.loaded)
+                elsewhere.push_back(claim.future);
+        }
+
+        get_thread_pool().parallel_for(pending.size(), [this, &pending](uint32 i) {
+            pending_load& load = pending[i];
+            try {
+                if (load.asset)
+                    load.asset_file = load_asset_file(load.file_path);
+                else
+                    load.j = _read_json(load.file_path);
+            } catch (...) {
+                load.error = std::current_exception();
+            }
+        });
+
+        wave.clear();
+        for (pending_load& load : pending) {
+            // failed loads are left out of the cache, so loading them again reads them again
+            if (load.error) {
+                if (load.asset)
+                    _fail(pending_assets, load.file_path, *load.asset_promise, load.error);
+                else
+                    _fail(pending_jsons, load.file_path, *load.json_promise, load.error);
+                continue;
+            }
+            if (load.asset) {
+                _fulfill(parsed_assets, pending_assets, load.file_path, std::move(load.asset_file), *load.asset_promise);
+                continue;
+            }
+            FileCachePin<json> j = _fulfill(parsed_jsons, pending_jsons, load.file_path, std::move(load.j), *load.json_promise);
+            wave.append(find_dependencies(*j));
+        }
+    }
+    for (std::shared_future<FileCachePin<json>>& future : elsewhere)
+        future.wait();
+}
+
+void FileCache::prefetch(const vector<FilePath>& roots) {
+    vector<FilePath> up_front;
+    {
+        std::lock_guard manifest_lock(manifest_mutex);
+        if (!manifest.loaded)
+            manifest.load();
+        up_front = manifest.closure(roots);
+    }
+
+    // Shared with the workers, which all finish before this returns
+    struct prefetch_state {
+        std::mutex              mutex;
+        std::condition_variable finished;
+        uint32                  outstanding = 0;
+        uset<FilePath>          issued;
+        vector<std::shared_future<FileCachePin<json>>>      elsewhere;
+        vector<std::shared_future<FileCachePin<AssetFile>>> assets;
+        DependencyEdges         edges;
+    } state;
+
+    function<void(const FilePath&)> issue;
+    auto read = [this, &state, &issue](const FilePath& file_path, const shared_ptr<std::promise<FileCachePin<json>>>& promise) {
+        vector<FilePath> dependencies;
+        bool loaded = false;
+        try {
+            json j = _read_json(file_path);
+            // edges are followed before this file is stored, so their reads start as early as possible
+            dependencies = find_dependencies(j);
+            for (const FilePath& dependency : dependencies)
+                issue(dependency);
+            _fulfill(parsed_jsons, pending_jsons, file_path, std::move(j), *promise);
+            loaded = true;
+        } catch (...) {
+            _fail(pending_jsons, file_path, *promise, std::current_exception());
+        }
+
+        // counted down either way, or prefetch never returns
+        std::lock_guard lock(state.mutex);
+        if (loaded)
+            state.edges[file_path] = std::move(dependencies);
+        if (--state.outstanding == 0)
+            state.finished.notify_all();
+    };
+    issue = [this, &state, &read, &issue](const FilePath& file_path) {
+        {
+            std::lock_guard lock(state.mutex);
+            if (!state.issued.insert(file_path).second)
+                return;
+        }
+        if (file_path.extension().starts_with(".sba")) {
+            std::lock_guard lock(state.mutex);
+            state.assets.push_back(load_asset_async(file_path));
+            return;
+        }
+
+        FileCacheClaim<json> claim = _claim(parsed_jsons, pending_jsons, file_path);
+        if (claim.promise) {
+            {
+                std::lock_guard lock(state.mutex);
+                state.outstanding++;
+            }
+            get_thread_pool().enqueue([&read, file_path, promise = claim.promise] { read(file_path, promise); });
+            return;
+        }
+        if (!claim.loaded) {
+            std::lock_guard lock(state.mutex);
+            state.elsewhere.push_back(claim.future);
+            return;
+        }
+
+        // already loaded, but what it depends on might not be
+        vector<FilePath> dependencies = find_dependencies(*claim.loaded);
+        {
+            std::lock_guard lock(state.mutex);
+            state.edges[file_path] = dependencies;
+        }
+        for (const FilePath& dependency : dependencies)
+            issue(dependency);
+    };
+
+    for (const FilePath& file_path : up_front)
+        issue(file_path);
+    {
+        std::unique_lock lock(state.mutex);
+        state.finished.wait(lock, [&state] { return state.outstanding == 0; });
+    }
+    for (std::shared_future<FileCachePin<json>>& future : state.elsewhere)
+        future.wait();
+    for (std::shared_future<FileCachePin<AssetFile>>& future : state.assets)
+        future.wait();
+
+    std::lock_guard manifest_lock(manifest_mutex);
+    for (auto& [file_path, dependencies] : state.edges) {
+        auto it = manifest.dependencies.find(file_path);
+        if (it == manifest.dependencies.end() || it->second.internal != dependencies.internal) {
+            manifest.dependencies[file_path] = std::move(dependencies);
+            manifest.changed = true;
+        }
+    }
+    if (manifest.changed)
+        manifest.save();
+}
+
+FileCachePin<lazy_json> FileCache::load_json_lazy(const FilePath& file_path) {
+    {
+        std::shared_lock lock(mutex);
+        if (auto it = lazy_jsons.find(file_path); it != lazy_jsons.end()) {
+            _touch(it->second);
+            return it->second.value;
+        }
+    }
+
+    lazy_json lazy;
+    FileCachePin<json> parsed = nullptr;
+    {
+        std::shared_lock lock(mutex);
+        if (auto parsed_it = parsed_jsons.find(file_path); parsed_it != parsed_jsons.end())
+            parsed = parsed_it->second.value;
+    }
+    if (parsed) {
+        // already fully parsed, the lazy view just shares the values
+        for (auto& [key, value] : *parsed)
+            lazy.members[key].parsed = value;
+    } else {
+        if (print_file_load_info)
+            log(BasicMessage{.str=fmt_("Scanning json: {}", file_path.abs_string()), .group = "asset"});
+        lazy = parse_lazy_file(file_path.abs_string());
+        // cached entries outlive the call, and a mapped file can't be truncated safely, or at all on Windows
+        lazy.copy_source();
+    }
+
+    uint64 bytes = memory_usage(lazy);
+    FileCachePin<lazy_json> pin = make_shared<lazy_json>(std::move(lazy));
+    vector<shared_ptr<const void>> released;
+    std::unique_lock lock(mutex);
+    if (auto it = lazy_jsons.find(file_path); it != lazy_jsons.end())
+        return it->second.value;
+    _store(lazy_jsons, file_path, pin, bytes);
+    released = _evict();
+    return pin;
 }
 
-AssetFile& FileCache::load_asset(const FilePath& file_path) {
-    if (parsed_assets.contains(file_path))
-        return parsed_assets[file_path];
+FileCachePin<AssetFile> FileCache::load_asset(const FilePath& file_path) {
+    FileCacheClaim<AssetFile> claim = _claim(parsed_assets, pending_assets, file_path);
+    if (claim.loaded)
+        return claim.loaded;
+    if (!claim.promise)
+        return claim.future.get();
 
     if (print_file_load_info)
         log(BasicMessage{.str=fmt_("Loading asset: {}", file_path.abs_string()), .group = "asset"});
-    return parsed_assets[file_path] = load_asset_file(file_path);
+    try {
+        return _fulfill(parsed_assets, pending_assets, file_path, load_asset_file(file_path), *claim.promise);
+    } catch (...) {
+        _fail(pending_assets, file_path, *claim.promise, std::current_exception());
+        throw;
+    }
 }
 
-vector<FilePath> FileCache::load_dependencies(json& j) {
+std::shared_future<FileCachePin<AssetFile>> FileCache::load_asset_async(const FilePath& file_path) {
+    FileCacheClaim<AssetFile> claim = _claim(parsed_assets, pending_assets, file_path);
+    if (claim.loaded) {
+        std::promise<FileCachePin<AssetFile>> ready;
+        ready.set_value(claim.loaded);
+        return ready.get_future().share();
+    }
+    if (claim.promise) {
+        get_thread_pool().enqueue([this, file_path, promise = claim.promise] {
+            try {
+                _fulfill(parsed_assets, pending_assets, file_path, load_asset_file(file_path), *promise);
+            } catch (...) {
+                _fail(pending_assets, file_path, *promise, std::current_exception());
+            }
+        });
+    }
+    return claim.future;
+}
+
+vector<FilePath> FileCache::load_dependencies(const json& j) {
     vector<FilePath> list;
-    if (j.contains("dependencies")) {
-        for (const json_value& jv : j["dependencies"]->get_list()) {
+    if (auto it = j.find("dependencies"); it != j.end()) {
+        for (const json_value& jv : it->second->get_elements()) {
             const FilePath& file_path = list.push_back(from_jv_impl(jv, (FilePath*) 0));
 
             if (file_path.extension().starts_with(".sba"))
@@ -47,4 +584,67 @@ vector<FilePath> FileCache::load_dependencies(json& j) {
     return list;
 }
 
-}
\ No newline at end of file
+void FileCache::_load_dependencies_async(const json& j) {
+    for (const FilePath& dependency : find_dependencies(j)) {
+        if (dependency.extension().starts_with(".sba"))
+            load_asset_async(dependency);
+        else
+            load_json_async(dependency);
+    }
+}
+
+vector<FilePath> FileCache::peek_dependencies(const FilePath& file_path) {
+    FileCachePin<lazy_json> lazy = load_json_lazy(file_path);
+    vector<FilePath> list;
+    std::lock_guard lazy_lock(lazy_mutex);
+    if (const json_value* dependencies = lazy->get("dependencies")) {
+        for (const json_value& jv : dependencies->get_elements())
+            list.push_back(from_jv<FilePath>(jv));
+    }
+    return list;
+}
+
+static FilePath manifest_path() {
+    return FilePath("dependency_manifest" + string(Resource::extension()), FilePathLocation_Config);
+}
+
+void DependencyManifest::load() {
+    loaded = true;
+    FilePath file_path = manifest_path();
+    if (!file_path.exists())
+        return;
+    json j = parse_file(file_path.abs_string());
+    if (auto it = j.find("dependencies"); it != j.end())
+        dependencies = from_jv<DependencyEdges>(*it->second);
+}
+
+void DependencyManifest::save() {
+    json_writer writer;
+    bool opened = writer.open_file(manifest_path().abs_string());
+    check_else(opened)
+        return;
+    writer.begin_object();
+    writer.write_key("dependencies");
+    write_jv(writer, dependencies);
+    writer.end_object();
+    changed = !writer.close_file();
+}
+
+vector<FilePath> DependencyManifest::closure(const vector<FilePath>& roots) const {
+    vector<FilePath> reachable = roots;
+    uset<FilePath> seen;
+    for (const FilePath& root : roots)
+        seen.insert(root);
+    for (uint32 i = 0; i < reachable.size(); i++) {
+        auto it = dependencies.find(reachable[i]);
+        if (it == dependencies.end())
+            continue;
+        for (const FilePath& dependency : it->second) {
+            if (seen.insert(dependency).second)
+                reachable.push_back(dependency);
+        }
+    }
+    return reachable;
+}
+
+}
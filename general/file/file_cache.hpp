@@ -1,23 +1,153 @@
 #pragma once
 
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <shared_mutex>
+
 #include "general/file/json.hpp"
+#include "general/file/json_lazy.hpp"
 #include "general/file/file_path.hpp"
 #include "asset_loader.hpp"
 
 namespace spellbook {
 
+// Each json's direct dependencies
+using DependencyEdges = umap<FilePath, vector<FilePath>>;
+JSON_COLUMNAR(DependencyEdges);
+
+// The dependency graph as of the last prefetch, kept in the config directory so the next start can issue reads
+// for the whole graph at once instead of discovering it a level at a time
+struct DependencyManifest {
+    DependencyEdges dependencies;
+    bool loaded  = false;
+    bool changed = false;
+
+    void load();
+    void save();
+    // Everything reachable from the roots according to the manifest, roots included
+    vector<FilePath> closure(const vector<FilePath>& roots) const;
+};
+
+// Holding one keeps the entry from being evicted, and keeps the value alive if it's dropped from the cache anyway.
+// Reset it to unpin.
+template <typename T>
+using FileCachePin = shared_ptr<T>;
+
+template <typename T>
+struct FileCacheEntry {
+    FileCachePin<T> value;
+    // estimated when stored
+    uint64 bytes     = 0;
+    uint64 last_used = 0;
+};
+
+// Where a load stands when it's requested. Either it's already loaded, another thread is loading it and the future
+// resolves when that's done, or the promise is set and the requester has to load it and fulfill.
+template <typename T>
+struct FileCacheClaim {
+    FileCachePin<T> loaded;
+    std::shared_future<FileCachePin<T>> future;
+    shared_ptr<std::promise<FileCachePin<T>>> promise;
+};
+
+// A load in flight. invalidate drops the entry while the load runs on, so only the load whose promise is still
+// here gets to store its result.
+template <typename T>
+struct FileCachePending {
+    std::shared_future<FileCachePin<T>> future;
+    shared_ptr<std::promise<FileCachePin<T>>> promise;
+};
+
+struct FileCacheStats {
+    uint64 json_bytes  = 0;
+    uint64 lazy_bytes  = 0;
+    uint64 asset_bytes = 0;
+    uint64 loads         = 0;
+    // loads of files that had been evicted, a budget that's too tight shows up here
+    uint64 reloads       = 0;
+    uint64 evictions     = 0;
+    uint64 evicted_bytes = 0;
+
+    uint64 total_bytes() const { return json_bytes + lazy_bytes + asset_bytes; }
+};
+
+// Safe to use from any thread. A path is only ever loaded once at a time, later requests share the load in flight.
+// With a memory budget, the least recently used entries that nobody has pinned are evicted to stay under it.
 struct FileCache {
-    umap<FilePath, json> parsed_jsons;
-    umap<FilePath, AssetFile> parsed_assets;
+    // Guards the maps and stats, never held while a file is read or parsed
+    mutable std::shared_mutex mutex;
+    umap<FilePath, FileCacheEntry<json>> parsed_jsons;
+    umap<FilePath, FileCacheEntry<lazy_json>> lazy_jsons;
+    umap<FilePath, FileCacheEntry<AssetFile>> parsed_assets;
+    umap<FilePath, FileCachePending<json>> pending_jsons;
+    umap<FilePath, FileCachePending<AssetFile>> pending_assets;
+
+    // What each loaded json depends on, so a change can be traced back to everything depending on it
+    DependencyEdges dependency_edges;
+
+    // bytes, 0 for no limit
+    uint64 memory_budget = 0;
+    FileCacheStats stats;
+    uset<FilePath> evicted;
+    std::atomic<uint64> use_clock = 0;
+
+    // lazy_json parses members as they're read, so every use of one goes through this
+    std::mutex lazy_mutex;
+
+    std::mutex         manifest_mutex;
+    DependencyManifest manifest;
+
+    // Waits when another thread is loading the same file, so don't call it or load_asset from a thread pool job
+    FileCachePin<json> load_json(const FilePath& file_path);
+    // Loads on the thread pool, then starts its dependencies there too. Resolves once the file itself is loaded.
+    std::shared_future<FileCachePin<json>> load_json_async(const FilePath& file_path);
+    // Parses the files and everything they depend on across the thread pool, a wave of dependencies at a time.
+    // Afterwards load_json on any of them is a lookup, as long as the budget didn't evict them again.
+    void load_jsons(const vector<FilePath>& file_paths);
+    // Loads the roots and their whole dependency graph. Every edge is read on the thread pool as soon as it's
+    // found, and the manifest's graph is issued up front, so a chain of dependencies doesn't serialize its I/O.
+    void prefetch(const vector<FilePath>& roots);
+    // Only scans the file, members are parsed as they're read. load_json later reuses whatever was parsed.
+    // Lock lazy_mutex while using it if other threads might too.
+    FileCachePin<lazy_json> load_json_lazy(const FilePath& file_path);
+    FileCachePin<AssetFile> load_asset(const FilePath& file_path);
+    std::shared_future<FileCachePin<AssetFile>> load_asset_async(const FilePath& file_path);
+
+    vector<FilePath> load_dependencies(const json& j);
+    // The file's dependency list, without loading them or parsing the rest of the file
+    vector<FilePath> peek_dependencies(const FilePath& file_path);
 
-    json& load_json(const FilePath& file_path);
-    AssetFile& load_asset(const FilePath& file_path);
+    // Drops the file's entries so the next load reads it again. Pinned values stay alive for whoever holds them.
+    // A load already in flight still resolves its own waiters, but isn't cached. False if nothing was cached for it.
+    bool invalidate(const FilePath& file_path);
+    // Every loaded json that depends on the file, directly or not, nearest first
+    vector<FilePath> find_dependents(const FilePath& file_path) const;
 
-    vector<FilePath> load_dependencies(json& j);
+    // Evicts right away if the cache is already over
+    void set_memory_budget(uint64 bytes);
+    FileCacheStats get_stats() const;
 
+    template <typename T>
+    FileCacheClaim<T> _claim(umap<FilePath, FileCacheEntry<T>>& parsed, umap<FilePath, FileCachePending<T>>& pending, const FilePath& file_path);
+    template <typename T>
+    FileCachePin<T> _fulfill(umap<FilePath, FileCacheEntry<T>>& parsed, umap<FilePath, FileCachePending<T>>& pending, const FilePath& file_path, T&& value, std::promise<FileCachePin<T>>& promise);
+    // Drops the pending load so the next request reads the file again, and hands error to whoever waits on it
+    template <typename T>
+    void _fail(umap<FilePath, FileCachePending<T>>& pending, const FilePath& file_path, std::promise<FileCachePin<T>>& promise, std::exception_ptr error);
+    // Call with mutex held
+    template <typename T>
+    void _store(umap<FilePath, FileCacheEntry<T>>& parsed, const FilePath& file_path, const FileCachePin<T>& pin, uint64 bytes);
+    template <typename T>
+    void _touch(FileCacheEntry<T>& entry);
+    // Call with mutex held. What's evicted is handed back so it's freed after unlocking.
+    vector<shared_ptr<const void>> _evict();
+    json _read_json(const FilePath& file_path);
+    // Starts the dependencies without waiting on them, a pool job waiting on a job behind it in the queue never wakes
+    void _load_dependencies_async(const json& j);
 };
 
 FileCache& get_file_cache();
 
 
-}
\ No newline at end of file
+}
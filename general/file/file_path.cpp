@@ -1,5 +1,6 @@
 ﻿#include "file_path.hpp"
 
+#include <cstring>
 #include <filesystem>
 #include <magic_enum.hpp>
 #include <windows.h>
@@ -8,6 +9,8 @@
 
 #include "general/logger.hpp"
 #include "general/string.hpp"
+#include "general/file/file_view.hpp"
+#include "general/file/pack.hpp"
 #include "general/file/resource.hpp"
 
 namespace fs = std::filesystem;
@@ -61,6 +64,8 @@ bool FilePath::is_directory() const {
 bool FilePath::exists() const {
     if (location == FilePathLocation_Symbolic)
         return true;
+    if (location == FilePathLocation_Content && packed_file_exists(abs_string()))
+        return true;
     return fs::exists(abs_path());
 }
 
@@ -143,18 +148,29 @@ void FilePath::standardize(string& s, bool directory) {
             s.push_back('/');
 }
 
-FilePath from_jv_impl(const json_value& jv, FilePath* _) {
-    string s = from_jv<string>(jv);
+static FilePath file_path_from_saved(const string& s) {
     // we don't save directories, so can check for extension to see if it's symbolic
     bool has_period = s.find('.') != std::string::npos;
     bool has_slash = s.find('/') != std::string::npos || s.find('\\') != std::string::npos;
     return FilePath(s, (has_period && has_slash) ? FilePathLocation_Content : FilePathLocation_Symbolic);
 }
+
+FilePath from_jv_impl(const json_value& jv, FilePath* _) {
+    return file_path_from_saved(from_jv<string>(jv));
+}
+FilePath from_jv_impl(const json_node& node, FilePath* _) {
+    return file_path_from_saved(from_jv<string>(node));
+}
 json_value to_jv(const FilePath& value) {
     FilePath copy = value;
     copy.standardize();
     return to_jv(copy.rel_string());
 }
+void write_jv(json_writer& writer, const FilePath& value) {
+    FilePath copy = value;
+    copy.standardize();
+    writer.write_string(copy.rel_string());
+}
 
 FilePath operator""_content(const char* str, uint64 length) {
     return FilePath(std::string(str, length), FilePathLocation_Content);
@@ -261,41 +277,26 @@ void set_content_dir_path(string_view abs_path) {
 }
 
 string get_contents(const FilePath& file_name, bool binary) {
-    string path = file_name.abs_string();
-    FILE* f = fopen(path.c_str(), !binary ? "r" : "rb");
-    if (f == nullptr)
-        return {};
-
-    fseek(f, 0, SEEK_END);
-    size_t size = ftell(f) / sizeof(char);
-    string contents;
-    contents.resize(size);
-    rewind(f);
-
-    size_t read_bytes = fread(contents.data(), sizeof(char), size, f);
-
-    fclose(f);
-
-    contents.resize(std::min(strlen(contents.data()), read_bytes));
+    FileView file(file_name.abs_string());
+    string contents(file.view());
+    // matches what text mode reads did, crlf becomes lf. Embedded nulls are kept either way.
+    if (!binary) {
+        uint64 out = 0;
+        for (uint64 i = 0; i < contents.size(); i++) {
+            if (contents[i] != '\r' || i + 1 == contents.size() || contents[i + 1] != '\n')
+                contents[out++] = contents[i];
+        }
+        contents.resize(out);
+    }
     return contents;
 }
 
 vector<uint32> get_contents_uint32(const FilePath& file_name, bool binary) {
-    string path = file_name.abs_string();
-    FILE* f = fopen(path.c_str(), !binary ? "r" : "rb");
-    if (f == nullptr)
-        return {};
-
-    fseek(f, 0, SEEK_END);
-    size_t    size = ftell(f) / sizeof(uint32);
+    FileView file(file_name.abs_string());
     vector<uint32> contents;
-    contents.resize(size);
-    rewind(f);
-
-    fread(&contents[0], sizeof(uint32), size, f);
-
-    fclose(f);
-
+    contents.resize(file.size / sizeof(uint32));
+    if (!contents.empty())
+        memcpy(contents.data(), file.data, contents.bsize());
     return contents;
 }
 
@@ -59,7 +59,9 @@ struct FilePath {
 };
 
 FilePath from_jv_impl(const json_value& jv, FilePath* _);
+FilePath from_jv_impl(const json_node& node, FilePath* _);
 json_value to_jv(const FilePath& value);
+void write_jv(json_writer& writer, const FilePath& value);
 
 uint64 hash_path(const FilePath& file_path);
 
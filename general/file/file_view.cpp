@@ -0,0 +1,127 @@
+#include "file_view.hpp"
+
+#include <utility>
+
+#include "general/file/pack.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace spellbook {
+
+FileView::FileView(FileView&& other) noexcept {
+    *this = std::move(other);
+}
+
+FileView& FileView::operator=(FileView&& other) noexcept {
+    if (this != &other) {
+        close();
+        data   = std::exchange(other.data, nullptr);
+        size   = std::exchange(other.size, 0);
+        opened = std::exchange(other.opened, false);
+        owner  = std::move(other.owner);
+    }
+    return *this;
+}
+
+FileView::~FileView() {
+    close();
+}
+
+bool FileView::open(const string& file_name) {
+    close();
+    // packs that loose files don't override answer first, so a shipped build doesn't look for loose files at all
+    if (open_packed(file_name, *this, true))
+        return true;
+    return _map(file_name) || open_packed(file_name, *this, false);
+}
+
+#ifdef _WIN32
+
+bool FileView::_map(const string& file_name) {
+    HANDLE file = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) {
+        CloseHandle(file);
+        return false;
+    }
+    // mapping an empty file fails, there's nothing to map anyway
+    if (file_size.QuadPart == 0) {
+        CloseHandle(file);
+        opened = true;
+        return true;
+    }
+
+    // the view keeps the mapping and the file referenced, neither handle is needed past this
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping != nullptr) {
+        data = (const char*) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+    if (data == nullptr)
+        return false;
+    size = file_size.QuadPart;
+    opened = true;
+    return true;
+}
+
+void FileView::close() {
+    if (data != nullptr && owner == nullptr)
+        UnmapViewOfFile(data);
+    data   = nullptr;
+    size   = 0;
+    opened = false;
+    owner  = nullptr;
+}
+
+#else
+
+bool FileView::_map(const string& file_name) {
+    int descriptor = ::open(file_name.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor < 0)
+        return false;
+
+    struct stat status;
+    if (fstat(descriptor, &status) != 0 || !S_ISREG(status.st_mode)) {
+        ::close(descriptor);
+        return false;
+    }
+    opened = true;
+    if (status.st_size > 0) {
+        // the mapping keeps the file referenced, the descriptor isn't needed past this
+        void* mapped = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapped == MAP_FAILED) {
+            opened = false;
+        } else {
+            madvise(mapped, status.st_size, MADV_SEQUENTIAL);
+            data = (const char*) mapped;
+            size = status.st_size;
+        }
+    }
+    ::close(descriptor);
+    return opened;
+}
+
+void FileView::close() {
+    if (data != nullptr && owner == nullptr)
+        munmap((void*) data, size);
+    data   = nullptr;
+    size   = 0;
+    opened = false;
+    owner  = nullptr;
+}
+
+#endif
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <memory>
+
+#include "general/vector.hpp"
+#include "general/string.hpp"
+
+namespace spellbook {
+
+// Read only mapping of a whole file. The bytes stay valid for as long as the view is open, and the file is never
+// copied into user space, so parsers can work straight out of the page cache.
+struct FileView {
+    const char* data = nullptr;
+    uint64      size = 0;
+    bool        opened = false;
+
+    // Set when the bytes belong to something else, like a mounted pack or a decompressed copy of a packed file
+    std::shared_ptr<const void> owner;
+
+    FileView() = default;
+    explicit FileView(const string& file_name) { open(file_name); }
+    FileView(FileView&& other) noexcept;
+    FileView& operator=(FileView&& other) noexcept;
+    FileView(const FileView&) = delete;
+    FileView& operator=(const FileView&) = delete;
+    ~FileView();
+
+    // False if the file can't be opened or mapped. Empty files open with no data. Content files can also come out
+    // of a mounted pack, see mount_pack.
+    bool open(const string& file_name);
+    void close();
+
+    string_view       view() const { return string_view(data, size); }
+    span<const uint8> bytes() const { return span<const uint8>((const uint8*) data, size); }
+
+    bool _map(const string& file_name);
+};
+
+}
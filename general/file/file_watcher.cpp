@@ -0,0 +1,254 @@
+#include "file_watcher.hpp"
+
+#include <algorithm>
+#include <filesystem>
+
+#include "extension/fmt.hpp"
+#include "general/logger.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace spellbook {
+
+FileWatcher::~FileWatcher() {
+    stop();
+}
+
+// Keeps the first of each path, in the order they came
+static void add_change(vector<string>& changed, uset<string>& seen, string relative) {
+    std::replace(relative.begin(), relative.end(), '\\', '/');
+    if (seen.insert(relative).second)
+        changed.push_back(std::move(relative));
+}
+
+#ifdef _WIN32
+
+bool FileWatcher::start(const string& root_dir) {
+    stop();
+    root = root_dir;
+    HANDLE directory = CreateFileA(root.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if (directory == INVALID_HANDLE_VALUE)
+        return false;
+
+    directory_handle = directory;
+    auto* ov = new OVERLAPPED{};
+    ov->hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    overlapped = ov;
+    buffer.resize(64 * 1024);
+    watching = _issue_read();
+    if (!watching)
+        stop();
+    return watching;
+}
+
+void FileWatcher::stop() {
+    if (directory_handle != nullptr) {
+        // the cancelled read still writes to overlapped and buffer until it completes, wait for it before freeing them
+        if (read_pending) {
+            DWORD bytes = 0;
+            CancelIo(directory_handle);
+            GetOverlappedResult(directory_handle, (OVERLAPPED*) overlapped, &bytes, TRUE);
+            read_pending = false;
+        }
+        CloseHandle(directory_handle);
+        directory_handle = nullptr;
+    }
+    if (overlapped != nullptr) {
+        auto* ov = (OVERLAPPED*) overlapped;
+        if (ov->hEvent != nullptr)
+            CloseHandle(ov->hEvent);
+        delete ov;
+        overlapped = nullptr;
+    }
+    buffer.clear();
+    unsettled.clear();
+    watching = false;
+}
+
+bool FileWatcher::_issue_read() {
+    auto* ov = (OVERLAPPED*) overlapped;
+    ResetEvent(ov->hEvent);
+    DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE;
+    read_pending = ReadDirectoryChangesW(directory_handle, buffer.data(), buffer.size(), TRUE, filter, nullptr, ov, nullptr);
+    return read_pending;
+}
+
+// Last write fires on every write, a file the writer still holds open can't be opened without sharing yet.
+// Gone files and directories count as settled.
+static bool is_settled(const string& path) {
+    DWORD attributes = GetFileAttributesA(path.c_str());
+    if (attributes == INVALID_FILE_ATTRIBUTES || (attributes & FILE_ATTRIBUTE_DIRECTORY))
+        return true;
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return GetLastError() != ERROR_SHARING_VIOLATION;
+    CloseHandle(file);
+    return true;
+}
+
+vector<string> FileWatcher::poll() {
+    vector<string> changed;
+    if (!watching)
+        return changed;
+
+    uset<string> seen;
+    vector<string> touched;
+    DWORD bytes = 0;
+    while (GetOverlappedResult(directory_handle, (OVERLAPPED*) overlapped, &bytes, FALSE)) {
+        read_pending = false;
+        // an empty result means the buffer overflowed and the changes are lost
+        if (bytes == 0)
+            log_warning(fmt_("Too many changes under {} at once, some weren't seen", root), "file");
+
+        uint32 offset = 0;
+        while (bytes > 0) {
+            auto* info = (FILE_NOTIFY_INFORMATION*) (buffer.data() + offset);
+            int32 name_length = info->FileNameLength / sizeof(WCHAR);
+            int32 length = WideCharToMultiByte(CP_UTF8, 0, info->FileName, name_length, nullptr, 0, nullptr, nullptr);
+            string relative(length, '\0');
+            WideCharToMultiByte(CP_UTF8, 0, info->FileName, name_length, relative.data(), length, nullptr, nullptr);
+            add_change(touched, seen, std::move(relative));
+
+            if (info->NextEntryOffset == 0)
+                break;
+            offset += info->NextEntryOffset;
+        }
+
+        if (!_issue_read()) {
+            log_warning(fmt_("Stopped watching {}", root), "file");
+            stop();
+            return changed;
+        }
+    }
+    if (GetLastError() != ERROR_IO_INCOMPLETE) {
+        read_pending = false;
+        log_warning(fmt_("Stopped watching {}", root), "file");
+        stop();
+        return changed;
+    }
+
+    // held back files that went quiet since the last poll are reported even if something still has them open
+    uset<string> seen_changed;
+    for (auto it = unsettled.begin(); it != unsettled.end();) {
+        if (!seen.contains(*it)) {
+            add_change(changed, seen_changed, *it);
+            it = unsettled.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (string& relative : touched) {
+        if (is_settled(root + "/" + relative)) {
+            unsettled.erase(relative);
+            add_change(changed, seen_changed, std::move(relative));
+        } else {
+            unsettled.insert(std::move(relative));
+        }
+    }
+    return changed;
+}
+
+#else
+
+static constexpr uint32 watch_mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CREATE;
+
+bool FileWatcher::start(const string& root_dir) {
+    stop();
+    root = root_dir;
+    if (!root.empty() && root.back() != '/')
+        root.push_back('/');
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0)
+        return false;
+
+    // nothing to report yet, whatever's there already is loaded fresh
+    vector<string> existing;
+    _watch_directory("", existing);
+    watching = !directories.empty();
+    if (!watching)
+        stop();
+    return watching;
+}
+
+void FileWatcher::stop() {
+    if (inotify_fd >= 0)
+        close(inotify_fd);
+    inotify_fd = -1;
+    directories.clear();
+    watching = false;
+}
+
+void FileWatcher::_watch_directory(const string& relative, vector<string>& changed) {
+    int32 watch = inotify_add_watch(inotify_fd, (root + relative).c_str(), watch_mask);
+    if (watch < 0)
+        return;
+    directories[watch] = relative;
+
+    std::error_code error;
+    for (const fs::directory_entry& entry : fs::directory_iterator(root + relative, error)) {
+        string child = relative + entry.path().filename().string();
+        if (entry.is_directory(error))
+            _watch_directory(child + "/", changed);
+        else
+            changed.push_back(std::move(child));
+    }
+}
+
+vector<string> FileWatcher::poll() {
+    vector<string> changed;
+    if (!watching)
+        return changed;
+
+    uset<string> seen;
+    alignas(inotify_event) char buffer[16 * 1024];
+    while (true) {
+        ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+        if (length <= 0)
+            break;
+
+        for (char* at = buffer; at < buffer + length;) {
+            auto* event = (inotify_event*) at;
+            at += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                log_warning(fmt_("Too many changes under {} at once, some weren't seen", root), "file");
+                continue;
+            }
+            auto directory = directories.find(event->wd);
+            if (directory == directories.end())
+                continue;
+            if (event->mask & IN_IGNORED) {
+                directories.erase(directory);
+                continue;
+            }
+            string relative = directory->second + (event->len > 0 ? event->name : "");
+
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    vector<string> created;
+                    _watch_directory(relative + "/", created);
+                    for (string& file : created)
+                        add_change(changed, seen, std::move(file));
+                }
+                continue;
+            }
+            // a new file is reported once it's closed, not while it's still being written
+            if (event->mask & IN_CREATE)
+                continue;
+            add_change(changed, seen, std::move(relative));
+        }
+    }
+    return changed;
+}
+
+#endif
+
+}
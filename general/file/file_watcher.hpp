@@ -0,0 +1,49 @@
+#pragma once
+
+#include "general/umap.hpp"
+#include "general/vector.hpp"
+#include "general/string.hpp"
+
+namespace spellbook {
+
+// Reports files changed anywhere under a directory. It's polled rather than calling back, so the caller picks the
+// thread that handles changes. inotify on linux, ReadDirectoryChangesW on windows.
+struct FileWatcher {
+    string root;
+    bool   watching = false;
+
+#ifdef _WIN32
+    void* directory_handle = nullptr;
+    // OVERLAPPED, kept opaque so windows.h stays out of the header
+    void* overlapped = nullptr;
+    vector<uint8> buffer;
+    // The kernel owns overlapped and buffer while a read is pending
+    bool read_pending = false;
+    // Written files still held open by the writer, reported once they can be opened exclusively or go quiet for a poll
+    uset<string> unsettled;
+#else
+    int32 inotify_fd = -1;
+    // inotify doesn't recurse, so every directory has its own watch. Paths are relative to root.
+    umap<int32, string> directories;
+#endif
+
+    FileWatcher() = default;
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+    ~FileWatcher();
+
+    bool start(const string& root_dir);
+    void stop();
+    // Files written, created, renamed or deleted since the last poll, relative to root, each listed once. Never blocks.
+    // Files still being written are left for a later poll.
+    vector<string> poll();
+
+#ifdef _WIN32
+    bool _issue_read();
+#else
+    // Files already in a new directory are added to changed, they were created before the watch was
+    void _watch_directory(const string& relative, vector<string>& changed);
+#endif
+};
+
+}
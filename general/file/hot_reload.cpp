@@ -0,0 +1,96 @@
+#include "hot_reload.hpp"
+
+#include <chrono>
+
+#include "extension/fmt.hpp"
+#include "general/logger.hpp"
+#include "general/file/resource.hpp"
+
+namespace spellbook {
+
+HotReload& get_hot_reload() {
+    static HotReload hot_reload;
+    return hot_reload;
+}
+
+bool HotReload::start() {
+    bool started = watcher.start(get_content_dir_path());
+    if (!started)
+        log_warning(fmt_("Can't watch {} for changes", get_content_dir_path()), "file");
+    return started;
+}
+
+void HotReload::stop() {
+    watcher.stop();
+    reloading.clear();
+}
+
+void HotReload::subscribe(function<void(const FilePath&)> listener) {
+    listeners.push_back(std::move(listener));
+}
+
+static bool resource_cached(const FilePath& file_path) {
+    for (ResourceCacheHooks& hooks : resource_cache_hooks()) {
+        if (hooks.contains(file_path))
+            return true;
+    }
+    return false;
+}
+
+static void reload_resources(const FilePath& file_path) {
+    for (ResourceCacheHooks& hooks : resource_cache_hooks())
+        hooks.reload(file_path);
+}
+
+template <typename T>
+static bool ready(const std::shared_future<T>& future) {
+    return !future.valid() || future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+void HotReload::update() {
+    FileCache& file_cache = get_file_cache();
+    for (const string& relative : watcher.poll()) {
+        // assigned rather than constructed, standardizing a deleted file would take it for a directory
+        FilePath file_path;
+        file_path.value = relative;
+        string extension = file_path.extension();
+        bool is_json = extension.starts_with(".sbj");
+        if (!is_json && !extension.starts_with(".sba"))
+            continue;
+
+        pending_reload reload = {.file_path = file_path, .dependents = file_cache.find_dependents(file_path)};
+        bool cached = file_cache.invalidate(file_path);
+        if (!cached && reload.dependents.empty() && !resource_cached(file_path))
+            continue;
+
+        if (file_path.exists()) {
+            if (is_json)
+                reload.json_load = file_cache.load_json_async(file_path);
+            else
+                reload.asset_load = file_cache.load_asset_async(file_path);
+        }
+        // saved again before the last reload finished, only the latest matters
+        reloading.remove_if([&file_path](const pending_reload& pending) { return pending.file_path == file_path; }, false);
+        reloading.push_back(std::move(reload));
+    }
+
+    for (uint32 i = 0; i < reloading.size();) {
+        pending_reload& reload = reloading[i];
+        if (!ready(reload.json_load) || !ready(reload.asset_load)) {
+            i++;
+            continue;
+        }
+
+        reload_resources(reload.file_path);
+        for (const FilePath& dependent : reload.dependents)
+            reload_resources(dependent);
+        for (auto& listener : listeners) {
+            listener(reload.file_path);
+            for (const FilePath& dependent : reload.dependents)
+                listener(dependent);
+        }
+        reloading.remove_index(i, true);
+    }
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <future>
+
+#include "general/function.hpp"
+#include "general/file/file_cache.hpp"
+#include "general/file/file_path.hpp"
+#include "general/file/file_watcher.hpp"
+
+namespace spellbook {
+
+// Watches the content directory and reloads what changed, along with every resource that depends on it. Only the
+// changed files are parsed again, and that happens on the thread pool. Dependents are rebuilt from what's cached.
+struct HotReload {
+    struct pending_reload {
+        FilePath file_path;
+        // the reparse to wait for, neither is set when the file was deleted
+        std::shared_future<FileCachePin<json>>      json_load;
+        std::shared_future<FileCachePin<AssetFile>> asset_load;
+        vector<FilePath> dependents;
+    };
+
+    FileWatcher watcher;
+    vector<pending_reload> reloading;
+    vector<function<void(const FilePath&)>> listeners;
+
+    bool start();
+    void stop();
+    // Call once a frame on the main thread, the resource caches aren't safe anywhere else
+    void update();
+    // Called from update with each changed file once it's reloaded, then with each of its dependents
+    void subscribe(function<void(const FilePath&)> listener);
+};
+
+HotReload& get_hot_reload();
+
+}
@@ -1,19 +1,15 @@
 #include "json.hpp"
 
-#include <sstream>
-#include <fstream>
-#include <iomanip>
-#include <filesystem>
-#include <dtoa/dtoa.h>
+#include <istream>
+#include <iterator>
 
-using std::visit;
-using std::ifstream;
-using std::istringstream;
-using std::ofstream;
-using std::ostringstream;
-using std::to_string;
+#include "extension/fmt.hpp"
+#include "general/logger.hpp"
+#include "general/file/file_view.hpp"
+#include "general/file/json_reader.hpp"
+#include "general/file/json_binary.hpp"
 
-namespace fs = std::filesystem;
+using std::visit;
 
 namespace spellbook {
 
@@ -58,192 +54,297 @@ string from_jv_impl(const json_value& jv, string* _) {
     return get<string>(jv.value);
 }
 
-json parse(string& contents) {
-    istringstream iss(contents);
-    return parse_json(iss);
+void write_jv(json_writer& writer, const json_value& jv) {
+    visit(overloaded {
+            [&](const json& a) { write_jv(writer, a); },
+            [&](const vector<json_value>& a) {
+                writer.begin_list();
+                for (const json_value& e : a)
+                    write_jv(writer, e);
+                writer.end_list();
+            },
+            [&](const string& a) { writer.write_string(a); },
+            [&](bool a) { writer.write_bool(a); },
+            [&](int64 a) { writer.write_int(a); },
+            [&](double a) { writer.write_double(a); }
+        },
+        jv.value);
 }
 
-json parse_file(const string& file_name) {
-    ifstream ifs(file_name);
-    if (ifs.is_open())
-        return parse_json(ifs);
-    return json {};
+void write_jv(json_writer& writer, const json& input_json) {
+    writer.begin_object();
+    for (auto& [key, value] : input_json) {
+        writer.write_key(key.view());
+        write_jv(writer, *value);
+    }
+    writer.end_object();
 }
 
-json parse_json(istream& iss) {
+void write_jv(json_writer& writer, const char* input_string) {
+    writer.write_string(input_string);
+}
+
+void write_jv(json_writer& writer, const string& input_string) {
+    writer.write_string(input_string);
+}
+
+void write_jv(json_writer& writer, bool input_bool) {
+    writer.write_bool(input_bool);
+}
+
+json_value from_jv_impl(const json_node& node, json_value* _) {
+    json_value jv;
+    switch (node.type()) {
+        case json_tape_object: jv.value = json_variant{from_jv<json>(node)}; break;
+        case json_tape_list: {
+            vector<json_value> list;
+            list.reserve(node.size());
+            for (json_node e : node.elements())
+                list.push_back(from_jv<json_value>(e));
+            jv.value = json_variant{std::move(list)};
+        } break;
+        case json_tape_string: jv.value = json_variant{string(node.get_string())}; break;
+        case json_tape_int: jv.value = json_variant{node.get_int()}; break;
+        case json_tape_double: jv.value = json_variant{node.get_double()}; break;
+        case json_tape_bool: jv.value = json_variant{node.get_bool()}; break;
+        // the DOM has no null, parse reads it as an empty object too
+        case json_tape_null: break;
+    }
+    return jv;
+}
+
+json from_jv_impl(const json_node& node, json* _) {
+    json j;
+    for (auto [k, val] : node.members())
+        j[json_key::intern(k)] = make_shared<json_value>(from_jv<json_value>(val));
+    return j;
+}
+
+bool from_jv_impl(const json_node& node, bool* _) {
+    return node.get_bool();
+}
+
+string from_jv_impl(const json_node& node, string* _) {
+    return string(node.get_string());
+}
+
+static json_value parse_value(json_reader& reader);
+
+static json parse_object_body(json_reader& reader) {
     json   j;
-    string word;
-    char   c;
-    iss.get(c);
-    if (c != '{')
-        __debugbreak(); // invalid start
-    iss.unget();
-
-    while (iss) {
-        // skip bullshit
-        iss.get(c);
-        while ((c == ',' || c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\f' || c == '{') && iss.good()) {
-            iss.get(c);
+    string scratch;
+    reader.skip_whitespace();
+    if (reader.consume('}'))
+        return j;
+    do {
+        reader.skip_whitespace();
+        string_view key = reader.read_string(scratch);
+        reader.skip_whitespace();
+        if (!reader.consume(':'))
+            reader.fail("expected ':'");
+        if (reader.failed)
+            break;
+        // keys are interned before the value reuses scratch, first occurrence of a duplicate key wins
+        json_key interned = json_key::intern(key);
+        j.emplace(interned, make_shared<json_value>(parse_value(reader)));
+    } while (reader.next_or_close('}'));
+    return j;
+}
+
+static vector<json_value> parse_list_body(json_reader& reader) {
+    vector<json_value> values;
+    reader.skip_whitespace();
+    if (reader.consume(']'))
+        return values;
+    do {
+        values.emplace_back(parse_value(reader));
+    } while (reader.next_or_close(']'));
+    return values;
+}
+
+static json_value parse_value(json_reader& reader) {
+    reader.skip_whitespace();
+    switch (reader.peek()) {
+        case '{': {
+            reader.consume('{');
+            if (!reader.enter())
+                return json_value();
+            json_value value{json_variant{parse_object_body(reader)}};
+            reader.leave();
+            return value;
+        }
+        case '[': {
+            reader.consume('[');
+            if (!reader.enter())
+                return json_value();
+            json_value value{json_variant{parse_list_body(reader)}};
+            reader.leave();
+            return value;
+        }
+        case '"': {
+            string scratch;
+            string_view view = reader.read_string(scratch);
+            return json_value{json_variant{string(view)}};
         }
-        if (c == '}')
-            return j;
-        // don't unget because we expect key, parse_quote skips start "
-
-        word = parse_quote(iss);
-        iss.get(c);
-        while ((c == ',' || c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\f' || c == ':') && iss.good()) {
-            iss.get(c);
+        case 't': {
+            if (reader.read_literal("true"))
+                return json_value{json_variant{true}};
+        } break;
+        case 'f': {
+            if (reader.read_literal("false"))
+                return json_value{json_variant{false}};
+        } break;
+        case 'n': {
+            if (reader.read_literal("null"))
+                return json_value();
+        } break;
+        default: {
+            json_number number = reader.read_number();
+            if (number.is_int)
+                return json_value{json_variant{number.int_value}};
+            return json_value{json_variant{number.double_value}};
         }
-        iss.unget();
-        j.insert({word, make_shared<json_value>(parse_item(iss))});
     }
-    __debugbreak(); // missing end
+    reader.fail("expected value");
+    return json_value();
+}
+
+json parse(string_view contents, json_error* error) {
+    json_reader reader(contents);
+    reader.skip_bom();
+    reader.skip_whitespace();
+    json j;
+    if (reader.at_end())
+        return j;
+    if (reader.consume('{'))
+        j = parse_object_body(reader);
+    else
+        reader.fail("expected object");
+    if (error)
+        *error = reader.error;
     return j;
 }
 
-bool is_int(const string& s) {
-    return !s.empty() && find_if(s.begin(), s.end(), [](uint8 c) {
-        return !(isdigit(c) || c == '-');
-    }) == s.end();
+json parse_file(const string& file_name, json_error* error) {
+    FileView file(file_name);
+    if (!file.opened)
+        return json {};
+
+    json_error file_error;
+    json j;
+    span<const uint8> bytes = file.bytes();
+    if (is_json_binary(bytes)) {
+        if (!read_json_binary(bytes, j))
+            file_error.reason = "corrupt binary json";
+    } else {
+        j = parse(file.view(), &file_error);
+    }
+
+    if (error)
+        *error = file_error;
+    else if (file_error)
+        log_warning(fmt_("Malformed json: {}, {} at byte {}", file_name, file_error.reason, file_error.offset));
+    return j;
 }
 
-bool is_float(const string& s) {
-    return !s.empty() && find_if(s.begin(), s.end(), [](uint8 c) {
-        return !(isdigit(c) || c == '.' || c == '-' || c == 'e');
-    }) == s.end();
+// The stream versions read what's left of the stream, parse it from memory, then seek back to just past what was used
+template <typename T, typename Parse>
+static T parse_stream(istream& iss, Parse&& parse_from) {
+    std::streampos stream_start = iss.tellg();
+    string contents {std::istreambuf_iterator<char>(iss), std::istreambuf_iterator<char>()};
+    json_reader reader(contents);
+    T result = parse_from(reader);
+    iss.clear();
+    if (stream_start != std::streampos(-1))
+        iss.seekg(stream_start + std::streamoff(reader.offset()));
+    return result;
 }
-json_value parse_item(istream& iss) {
-    char c = ' ';
-    iss.get(c);
-    while ((c == ',' || c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\f') && iss.good())
-        iss.get(c);
-    if (c == '{') {
-        iss.unget();
-        return to_jv(parse_json(iss));
-    } else if (c == '[') {
-        return to_jv(parse_list(iss));
-    } else if (c == '"') {
-        return to_jv(parse_quote(iss));
-    } else {
-        if (isalpha(c)) {
-            string word;
-            while (isalpha(c)) {
-                word.push_back(c);
-                iss.get(c);
-            }
-            iss.unget();
-            if (word.rfind("true", 0) == 0)
-                return to_jv(true);
-            if (word.rfind("false", 0) == 0)
-                return to_jv(false);
-        } else {
-            string word;
-            while (isdigit(c) || c == '.' || c == '-' || c == 'e') {
-                word.push_back(c);
-                iss.get(c);
-            }
-            iss.unget();
-            if (is_int(word))
-                return to_jv(stoll(word));
-            if (is_float(word)) {
-                return to_jv(stod(word));
-            }
+
+json parse_json(istream& iss) {
+    return parse_stream<json>(iss, [](json_reader& reader) {
+        reader.skip_bom();
+        reader.skip_whitespace();
+        if (!reader.consume('{')) {
+            reader.fail("expected object");
+            return json {};
         }
-    }
-    return json_value();
+        return parse_object_body(reader);
+    });
+}
+
+json_value parse_item(string_view contents, json_error* error) {
+    json_reader reader(contents);
+    json_value value = parse_value(reader);
+    if (error)
+        *error = reader.error;
+    return value;
+}
+
+json_value parse_item(istream& iss) {
+    return parse_stream<json_value>(iss, [](json_reader& reader) {
+        reader.skip_whitespace();
+        while (reader.consume(','))
+            reader.skip_whitespace();
+        return parse_value(reader);
+    });
 }
 
 vector<json_value> parse_list(istream& iss) {
-    vector<json_value> values;
-    char               c;
-    while (iss) {
-        iss.get(c);
-        while ((c == ',' || c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\f' || c == ']') && iss.good()) {
-            if (c == ']')
-                return values;
-            iss.get(c);
-        }
-        iss.unget();
-        values.push_back(parse_item(iss));
-    }
-    __debugbreak(); // no closing brace
-    return values;
+    return parse_stream<vector<json_value>>(iss, [](json_reader& reader) {
+        return parse_list_body(reader);
+    });
 }
 
 string parse_quote(istream& iss) {
-    string out;
-    while (iss) {
-        char c;
-        iss.get(c);
-        if (c == '\\') {
-            iss.get(c);
-            if (c == 'n')
-                out.push_back('\n');
-            else
-                out.push_back(c);
-        } else {
-            if (c == '"')
-                break;
-            out.push_back(c);
-        }
-    }
-    return out;
+    return parse_stream<string>(iss, [](json_reader& reader) {
+        string scratch;
+        return string(reader.read_string_body(scratch));
+    });
+}
+
+void file_dump(const json& json, const string& file_name, bool pretty) {
+    json_writer writer(pretty);
+    if (!writer.open_file(file_name))
+        return;
+    write_jv(writer, json);
+    writer.close_file();
 }
 
-void file_dump(const json& json, const string& file_name) {
-    fs::create_directories(fs::path(file_name).parent_path());
-    ofstream ofs(file_name);
-    ofs << dump_json(json);
+string dump_json(const json& json, bool pretty) {
+    json_writer writer(pretty);
+    write_jv(writer, json);
+    return std::move(writer.out);
 }
 
-string dump_json(const json& json) {
-    ostringstream oss;
-    oss << "{";
-    bool init = false;
-    for (auto& [key, json_value] : json) {
-        if (init)
-            oss << ",";
-        oss << "\"" << key << "\":" << json_value->dump();
-        init = true;
+static uint64 json_value_memory_usage(const json_value& jv) {
+    return visit(overloaded{
+        [](const json& j) { return json_memory_usage(j); },
+        [](const vector<json_value>& list) {
+            uint64 bytes = list.internal.capacity() * sizeof(json_value);
+            for (const json_value& element : list)
+                bytes += json_value_memory_usage(element);
+            return bytes;
+        },
+        // short strings live inline
+        [](const string& s) { return s.capacity() > 15 ? uint64(s.capacity() + 1) : uint64(0); },
+        [](const auto&) { return uint64(0); }
+    }, jv.value);
+}
+
+uint64 json_memory_usage(const json& j) {
+    // a node per member, plus the shared value and its control block
+    uint64 bytes = j.size() * (sizeof(json::value_type) + sizeof(void*) + 1);
+    for (const auto& [key, value] : j) {
+        if (value)
+            bytes += sizeof(json_value) + 2 * sizeof(void*) + json_value_memory_usage(*value);
     }
-    oss << "}";
-    return oss.str();
-}
-
-string json_value::dump() const {
-    string s;
-    visit(overloaded {[&s](bool a) {
-                          s = a ? "true" : "false";
-                      },
-              [&s](int64 a) {
-                  s = to_string(a);
-              },
-              [&s](double a) {
-                  static char buffer[256];
-                  auto        size = dtoa(a, buffer);
-                  s                = string(buffer, size);
-              },
-              [&s](const string& a) {
-                  std::ostringstream oss;
-                  oss << std::quoted(a);
-                  s = oss.str();
-              },
-              [&s](const json& a) {
-                  s = dump_json(a);
-              },
-              [&s](const vector<json_value>& a) {
-                  s         = "[";
-                  bool init = false;
-                  for (auto jv : a) {
-                      if (init)
-                          s += ",";
-                      s += jv.dump();
-                      init = true;
-                  }
-                  s += "]";
-              }},
-        value);
-    return s;
+    return bytes;
+}
+
+string json_value::dump(bool pretty) const {
+    json_writer writer(pretty);
+    write_jv(writer, *this);
+    return std::move(writer.out);
 }
 
 } // namespace caj
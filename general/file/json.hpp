@@ -6,6 +6,10 @@
 #include <magic_enum.hpp>
 
 #include "general/umap.hpp"
+#include "general/hash.hpp"
+#include "general/file/json_key.hpp"
+#include "general/file/json_tape.hpp"
+#include "general/file/json_writer.hpp"
 
 using std::get;
 using std::istream;
@@ -29,7 +33,11 @@ template <typename J>
 concept float_concept = std::is_floating_point_v<J>;
 
 struct json_value;
-using json = umap<string, shared_ptr<json_value>>;
+using json = umap<json_key, shared_ptr<json_value>>;
+
+// Opt-in for writing a container column-wise, see JSON_COLUMNAR. Readers accept either form regardless.
+template <typename T>
+struct json_columnar : std::false_type {};
 
 // JSON lib works by converting everything to and from this type
 // Built-in types are declared here, User-types are declared there.
@@ -39,23 +47,35 @@ using json_variant = variant<json, vector<json_value>, string, bool, int64, doub
 struct json_value {
     json_variant value;
 
-    vector<json_value> get_list() const {
+    const vector<json_value>& get_list() const {
         return get<vector<json_value>>(value);
     }
+    span<const json_value> get_elements() const {
+        const vector<json_value>& list = get_list();
+        return span<const json_value>(list.data(), list.size());
+    }
+    const json& get_object() const {
+        return get<json>(value);
+    }
 
-    string dump() const;
+    string dump(bool pretty = false) const;
 };
 
-json               parse(string& contents);
-json               parse_file(const string& file_name);
+// error, when given, is filled in with why a malformed document stopped parsing
+json               parse(string_view contents, json_error* error = nullptr);
+// Logs malformed files, unless error is given to be filled in instead.
+json               parse_file(const string& file_name, json_error* error = nullptr);
 json               parse_json(istream& iss);
 json_value         parse_item(istream& iss);
+json_value         parse_item(string_view contents, json_error* error = nullptr);
 vector<json_value> parse_list(istream& iss);
 string             parse_quote(istream& iss);
 
-void   file_dump(const json& json, const string& file_name);
-string dump_json(const json& json);
+void   file_dump(const json& json, const string& file_name, bool pretty = false);
+string dump_json(const json& json, bool pretty = false);
 void   delete_json(json& j);
+// Rough heap footprint, keys aside since they're interned
+uint64 json_memory_usage(const json& j);
 
 template <typename JsonT> json_value                   to_jv(const vector<JsonT>& _vector);
 template <typename JsonT> json_value                   to_jv(const vector<shared_ptr<JsonT>>& _vector);
@@ -77,6 +97,8 @@ json_value to_jv(T input_enum);
 
 template <typename JsonT>
 json_value to_jv(const vector<JsonT>& _vector) {
+    if constexpr (json_columnar<vector<JsonT>>::value)
+        return to_jv_columns(_vector);
     vector<json_value> _list = {};
     for (const JsonT& e : _vector) {
         json_value jv  = to_jv(e);
@@ -95,10 +117,10 @@ json_value to_jv(const vector<JsonT>& _vector) {
             },
             jv.value);
         if (add)
-            _list.push_back(to_jv(e));
+            _list.push_back(std::move(jv));
     }
     json_value jv;
-    jv.value = json_variant{_list};
+    jv.value = json_variant{std::move(_list)};
     return jv;
 }
 
@@ -151,6 +173,20 @@ template <typename JsonT> json_value to_jv(const vector<shared_ptr<JsonT>>& _vec
 }
 
 template <typename JsonT1, typename JsonT2> json_value to_jv(umap<JsonT1, JsonT2> _map) {
+    if constexpr (json_columnar<umap<JsonT1, JsonT2>>::value) {
+        vector<json_value> keys;
+        vector<json_value> values;
+        keys.reserve(_map.size());
+        values.reserve(_map.size());
+        for (auto& [k, v] : _map) {
+            keys.push_back(to_jv(k));
+            values.push_back(to_jv(v));
+        }
+        json j;
+        j["keys"]   = make_shared<json_value>(to_jv(std::move(keys)));
+        j["values"] = make_shared<json_value>(to_jv(std::move(values)));
+        return to_jv(j);
+    }
     vector<json_value> _list = {};
     for (auto& [k, v] : _map) {
         json v_j{};
@@ -213,28 +249,176 @@ json_value to_jv(T input_enum) {
 }
 
 
+// Text encoding, mirrors to_jv but appends straight to a json_writer instead of building a json_value tree.
+// to_jv drops empty containers from lists, so these do too. Only the containers whose empty form is {} or [] count,
+// anything else with an empty() is written as usual.
+template <typename T>
+struct json_empty_drops : std::false_type {};
+template <typename JsonT>
+struct json_empty_drops<vector<JsonT>> : std::true_type {};
+template <typename JsonT>
+struct json_empty_drops<uset<JsonT>> : std::true_type {};
+// columnar maps still write their empty "keys" and "values" lists
+template <typename JsonT1, typename JsonT2>
+struct json_empty_drops<umap<JsonT1, JsonT2>> : std::bool_constant<!json_columnar<umap<JsonT1, JsonT2>>::value> {};
+
+template <typename JsonT>
+bool json_skips_in_list(const JsonT& value) {
+    if constexpr (json_empty_drops<JsonT>::value)
+        return value.empty();
+    else
+        return false;
+}
+
+template <typename JsonT>
+void write_jv(json_writer& writer, const vector<JsonT>& _vector) {
+    if constexpr (json_columnar<vector<JsonT>>::value) {
+        writer.begin_object();
+        if (!_vector.empty())
+            write_jv_columns(writer, _vector);
+        writer.end_object();
+        return;
+    }
+    writer.begin_list();
+    for (const JsonT& e : _vector) {
+        if (!json_skips_in_list(e))
+            write_jv(writer, e);
+    }
+    writer.end_list();
+}
+
+template <typename JsonT, size_t N>
+void write_jv(json_writer& writer, const std::array<JsonT, N>& _array) {
+    writer.begin_list();
+    for (const JsonT& e : _array)
+        write_jv(writer, e);
+    writer.end_list();
+}
+
+template <typename JsonT>
+void write_jv(json_writer& writer, const uset<JsonT>& _set) {
+    writer.begin_list();
+    for (const JsonT& e : _set) {
+        if (!json_skips_in_list(e))
+            write_jv(writer, e);
+    }
+    writer.end_list();
+}
+
+template <typename JsonT>
+void write_jv(json_writer& writer, const vector<shared_ptr<JsonT>>& _vector) {
+    writer.begin_list();
+    for (const shared_ptr<JsonT>& e : _vector)
+        write_jv(writer, *e);
+    writer.end_list();
+}
+
+template <typename JsonT1, typename JsonT2>
+void write_jv(json_writer& writer, const umap<JsonT1, JsonT2>& _map) {
+    if constexpr (json_columnar<umap<JsonT1, JsonT2>>::value) {
+        writer.begin_object();
+        writer.write_key("keys");
+        writer.begin_list();
+        for (auto& [k, v] : _map)
+            write_jv(writer, k);
+        writer.end_list();
+        writer.write_key("values");
+        writer.begin_list();
+        for (auto& [k, v] : _map)
+            write_jv(writer, v);
+        writer.end_list();
+        writer.end_object();
+        return;
+    }
+    writer.begin_list();
+    for (auto& [k, v] : _map) {
+        writer.begin_object();
+        writer.write_key("key");
+        write_jv(writer, k);
+        writer.write_key("value");
+        write_jv(writer, v);
+        writer.end_object();
+    }
+    writer.end_list();
+}
+
+template <typename JsonT1, typename JsonT2>
+void write_jv(json_writer& writer, const umap<shared_ptr<JsonT1>, JsonT2>& _map) {
+    writer.begin_list();
+    for (auto& [k, v] : _map) {
+        writer.begin_object();
+        writer.write_key("key");
+        write_jv(writer, *k);
+        writer.write_key("value");
+        write_jv(writer, v);
+        writer.end_object();
+    }
+    writer.end_list();
+}
+
+template <typename JsonT>
+void write_jv(json_writer& writer, const umap<string, JsonT>& _map) {
+    writer.begin_object();
+    for (auto& [k, v] : _map) {
+        writer.write_key(k);
+        write_jv(writer, v);
+    }
+    writer.end_object();
+}
+
+void write_jv(json_writer& writer, const json_value& jv);
+void write_jv(json_writer& writer, const json& input_json);
+void write_jv(json_writer& writer, const char* input_string);
+void write_jv(json_writer& writer, const string& input_string);
+void write_jv(json_writer& writer, bool input_bool);
+
+template <float_concept T>
+void write_jv(json_writer& writer, T input_float) {
+    writer.write_double(double(input_float));
+}
+
+template <int_concept T>
+void write_jv(json_writer& writer, T input_int) {
+    writer.write_int(int64(input_int));
+}
+
+template <enum_concept T>
+void write_jv(json_writer& writer, T input_enum) {
+    writer.write_string(magic_enum::enum_name(input_enum));
+}
+
+
 template <typename T>
 T from_jv(const json_value& jv) {
     return from_jv_impl(jv, (T*) 0);
 }
 
+template <typename T>
+T from_jv(const json& j) {
+    return from_jv_impl(j, (T*) 0);
+}
+
 template <typename JsonT>
 vector<JsonT> from_jv_impl(const json_value& jv, vector<JsonT>* _) {
-    vector<JsonT>      t;
-    vector<json_value> _list = jv.get_list();
-    t.reserve(t.size() + _list.size());
-    for (auto& e : _list) {
-        t.push_back(from_jv<JsonT>(e));
+    if constexpr (requires { from_jv_columns(jv.get_object(), (vector<JsonT>*) 0); }) {
+        if (std::holds_alternative<json>(jv.value))
+            return from_jv_columns(jv.get_object(), (vector<JsonT>*) 0);
     }
+    span<const json_value> _list = jv.get_elements();
+    vector<JsonT>           t;
+    t.reserve(_list.size());
+    for (const json_value& e : _list)
+        t.push_back(from_jv<JsonT>(e));
     return t;
 }
 
 template <typename JsonT, size_t N>
 std::array<JsonT, N> from_jv_impl(const json_value& jv, std::array<JsonT, N>* _) {
     std::array<JsonT, N> t;
-    vector<json_value> _list = jv.get_list();
     uint32 i = 0;
-    for (auto& e : _list) {
+    for (const json_value& e : jv.get_elements()) {
+        if (i >= N)
+            break;
         t[i++] = from_jv<JsonT>(e);
     }
     return t;
@@ -242,33 +426,46 @@ std::array<JsonT, N> from_jv_impl(const json_value& jv, std::array<JsonT, N>* _)
 
 template <typename JsonT>
 uset<JsonT> from_jv_impl(const json_value& jv, uset<JsonT>* _) {
-    uset<JsonT>      t;
-    vector<json_value> _list = jv.get_list();
-    for (auto& e : _list) {
+    uset<JsonT> t;
+    for (const json_value& e : jv.get_elements())
         t.insert(from_jv<JsonT>(e));
-    }
     return t;
 }
 
 template <typename JsonT>
 vector<shared_ptr<JsonT>> from_jv_impl(const json_value& jv, vector<shared_ptr<JsonT>>* _) {
+    span<const json_value>    _list = jv.get_elements();
     vector<shared_ptr<JsonT>> t;
-    vector<json_value>        _list = jv.get_list();
-    t.reserve(t.size() + _list.size());
-    for (auto& e : _list) {
+    t.reserve(_list.size());
+    for (const json_value& e : _list)
         t.push_back(make_shared<JsonT>(from_jv<JsonT>(e)));
-    }
     return t;
 }
 
 template <typename JsonS, typename JsonT>
 umap<JsonS, JsonT> from_jv_impl(const json_value& jv, umap<JsonS, JsonT>* _) {
     umap<JsonS, JsonT> t;
-    for (auto& value_json_value : jv.get_list()) {
-        json  value_json = from_jv<json>(value_json_value);
-        JsonS key        = from_jv<JsonS>(*value_json["key"]);
-        JsonT value      = from_jv<JsonT>(*value_json["value"]);
-        t[key]           = value;
+    if (std::holds_alternative<json>(jv.value)) {
+        const json& columns = jv.get_object();
+        auto keys_it   = columns.find("keys");
+        auto values_it = columns.find("values");
+        if (keys_it != columns.end() && values_it != columns.end() &&
+            std::holds_alternative<vector<json_value>>(keys_it->second->value) &&
+            std::holds_alternative<vector<json_value>>(values_it->second->value)) {
+            span<const json_value> keys   = keys_it->second->get_elements();
+            span<const json_value> values = values_it->second->get_elements();
+            t.reserve(keys.size());
+            for (uint32 i = 0; i < keys.size() && i < values.size(); i++)
+                t[from_jv<JsonS>(keys[i])] = from_jv<JsonT>(values[i]);
+            return t;
+        }
+    }
+    // null reads as an empty object, that and anything else that isn't a list is an empty map
+    if (!std::holds_alternative<vector<json_value>>(jv.value))
+        return t;
+    for (const json_value& value_json_value : jv.get_elements()) {
+        const json& value_json = value_json_value.get_object();
+        t[from_jv<JsonS>(*value_json.at("key"))] = from_jv<JsonT>(*value_json.at("value"));
     }
     return t;
 }
@@ -276,11 +473,9 @@ umap<JsonS, JsonT> from_jv_impl(const json_value& jv, umap<JsonS, JsonT>* _) {
 template <typename JsonS, typename JsonT>
 umap<shared_ptr<JsonS>, JsonT> from_jv_impl(const json_value& jv, umap<shared_ptr<JsonS>, JsonT>* _) {
     umap<shared_ptr<JsonS>, JsonT> t;
-    for (auto& value_json_value : jv.get_list()) {
-        json  value_json = from_jv<json>(value_json_value);
-        JsonS key        = make_shared<JsonS>(from_jv<JsonS>(*value_json["key"]));
-        JsonT value      = from_jv<JsonT>(*value_json["value"]);
-        t[key]           = value;
+    for (const json_value& value_json_value : jv.get_elements()) {
+        const json& value_json = value_json_value.get_object();
+        t[make_shared<JsonS>(from_jv<JsonS>(*value_json.at("key")))] = from_jv<JsonT>(*value_json.at("value"));
     }
     return t;
 }
@@ -288,9 +483,8 @@ umap<shared_ptr<JsonS>, JsonT> from_jv_impl(const json_value& jv, umap<shared_pt
 template <typename JsonT>
 umap<string, JsonT> from_jv_impl(const json_value& jv, umap<string, JsonT>* _) {
     umap<string, JsonT> t;
-    for (auto& [k, val] : get<json>(jv.value)) {
+    for (auto& [k, val] : jv.get_object())
         t[k] = from_jv<JsonT>(*val);
-    }
     return t;
 }
 
@@ -326,6 +520,115 @@ T from_jv_impl(const json_value& jv, T* _) {
     return t;
 }
 
+// Tape decoding, mirrors the json_value overloads above but reads straight out of a json_document
+template <typename T>
+T from_jv(const json_node& node) {
+    return from_jv_impl(node, (T*) 0);
+}
+
+template <typename JsonT>
+vector<JsonT> from_jv_impl(const json_node& node, vector<JsonT>* _) {
+    if constexpr (requires { from_jv_columns(node, (vector<JsonT>*) 0); }) {
+        if (node.is_object())
+            return from_jv_columns(node, (vector<JsonT>*) 0);
+    }
+    vector<JsonT> t;
+    t.reserve(node.size());
+    for (json_node e : node.elements())
+        t.push_back(from_jv<JsonT>(e));
+    return t;
+}
+
+template <typename JsonT, size_t N>
+std::array<JsonT, N> from_jv_impl(const json_node& node, std::array<JsonT, N>* _) {
+    std::array<JsonT, N> t;
+    uint32 i = 0;
+    for (json_node e : node.elements()) {
+        if (i >= N)
+            break;
+        t[i++] = from_jv<JsonT>(e);
+    }
+    return t;
+}
+
+template <typename JsonT>
+uset<JsonT> from_jv_impl(const json_node& node, uset<JsonT>* _) {
+    uset<JsonT> t;
+    for (json_node e : node.elements())
+        t.insert(from_jv<JsonT>(e));
+    return t;
+}
+
+template <typename JsonT>
+vector<shared_ptr<JsonT>> from_jv_impl(const json_node& node, vector<shared_ptr<JsonT>>* _) {
+    vector<shared_ptr<JsonT>> t;
+    t.reserve(node.size());
+    for (json_node e : node.elements())
+        t.push_back(make_shared<JsonT>(from_jv<JsonT>(e)));
+    return t;
+}
+
+template <typename JsonS, typename JsonT>
+umap<JsonS, JsonT> from_jv_impl(const json_node& node, umap<JsonS, JsonT>* _) {
+    umap<JsonS, JsonT> t;
+    if (node.is_object()) {
+        json_range<json_list_iterator> keys   = node.find("keys").elements();
+        json_range<json_list_iterator> values = node.find("values").elements();
+        t.reserve(node.find("keys").size());
+        for (auto k = keys.begin(), v = values.begin(); k != keys.end() && v != values.end(); ++k, ++v)
+            t[from_jv<JsonS>(*k)] = from_jv<JsonT>(*v);
+        return t;
+    }
+    for (json_node pair : node.elements())
+        t[from_jv<JsonS>(pair.find("key"))] = from_jv<JsonT>(pair.find("value"));
+    return t;
+}
+
+template <typename JsonS, typename JsonT>
+umap<shared_ptr<JsonS>, JsonT> from_jv_impl(const json_node& node, umap<shared_ptr<JsonS>, JsonT>* _) {
+    umap<shared_ptr<JsonS>, JsonT> t;
+    for (json_node pair : node.elements())
+        t[make_shared<JsonS>(from_jv<JsonS>(pair.find("key")))] = from_jv<JsonT>(pair.find("value"));
+    return t;
+}
+
+template <typename JsonT>
+umap<string, JsonT> from_jv_impl(const json_node& node, umap<string, JsonT>* _) {
+    umap<string, JsonT> t;
+    for (auto [k, val] : node.members())
+        t[string(k)] = from_jv<JsonT>(val);
+    return t;
+}
+
+// Copies the subtree out into the DOM
+json       from_jv_impl(const json_node& node, json* _);
+json_value from_jv_impl(const json_node& node, json_value* _);
+bool       from_jv_impl(const json_node& node, bool* _);
+string     from_jv_impl(const json_node& node, string* _);
+
+template <int_concept T>
+T from_jv_impl(const json_node& node, T* _) {
+    return (T) node.get_int();
+}
+
+template <float_concept T>
+T from_jv_impl(const json_node& node, T* _) {
+    return (T) node.get_double();
+}
+
+template <enum_concept T>
+T from_jv_impl(const json_node& node, T* _) {
+    if (node.is_string())
+        return magic_enum::enum_cast<T>(node.get_string()).value_or(T(0));
+    return T(node.get_int());
+}
+
+// Lets the column decoders take either document form
+inline span<const json_value> json_column_elements(const shared_ptr<json_value>& column) { return column->get_elements(); }
+inline json_range<json_list_iterator> json_column_elements(const json_node& column) { return column.elements(); }
+inline uint32 json_column_size(const shared_ptr<json_value>& column) { return column->get_elements().size(); }
+inline uint32 json_column_size(const json_node& column) { return column.size(); }
+
 }
 
 #define EXPAND(x) x
@@ -355,39 +658,146 @@ T from_jv_impl(const json_value& jv, T* _) {
 #define PASTE22(func, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, v15, v16, v17, v18, v19, v20, v21) PASTE2(func, v1) PASTE21(func, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, v15, v16, v17, v18, v19, v20, v21)
 #define PASTE23(func, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, v15, v16, v17, v18, v19, v20, v21, v22) PASTE2(func, v1) PASTE22(func, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, v15, v16, v17, v18, v19, v20, v21, v22)
 
-#define FROM_JSON_ELE(var)                                     \
-    if (j.contains(#var)) {                                    \
-        value.var = from_jv<decltype(value.var)>(*j.at(#var)); \
+// Members are matched in one pass over the object's keys. Each key's hash (precomputed for interned json keys) is
+// switched on the constexpr hashes of the member names, two members whose names collide fail to compile as duplicate cases.
+#define FROM_JSON_CASE(var)                                          \
+    case spellbook::hash_view(#var):                                 \
+        if (json_key_view(key) == #var)                              \
+            value.var = from_jv<decltype(value.var)>(member);        \
+        break;
+
+#define FROM_JSON_DISPATCH(...)                                      \
+    switch (json_key_hash(key)) {                                    \
+        EXPAND(PASTE(FROM_JSON_CASE, __VA_ARGS__))                   \
+        default: break;                                              \
     }
+
+// Column-wise vectors of a struct are an object of one list per member
+#define FROM_JSON_COLUMN_CASE(var)                                              \
+    case spellbook::hash_view(#var):                                            \
+        if (json_key_view(key) == #var) {                                       \
+            if (values.size() < json_column_size(column))                       \
+                values.resize(json_column_size(column));                        \
+            uint32 i = 0;                                                       \
+            for (const auto& element : json_column_elements(column))            \
+                values[i++].var = from_jv<decltype(values[0].var)>(element);    \
+        }                                                                       \
+        break;
+
 #define FROM_JSON_MEMBER(var)                      \
     if (j.contains(#var))                          \
         var = from_jv<decltype(var)>(*j.at(#var));
 
-#define FROM_JSON_IMPL(Type, ...)                             \
-    inline Type from_jv_impl(const json_value& jv, Type* _) { \
-       json j = from_jv<json>(jv);                            \
-       Type value;                                            \
-       EXPAND(PASTE(FROM_JSON_ELE, __VA_ARGS__))              \
-       return value;                                          \
+#define FROM_JSON_IMPL_TEMPLATE(Template, Type, ...)                      \
+    Template inline Type from_jv_impl(const json& j, Type* _) {           \
+       Type value;                                                        \
+       for (auto& [key, member_ptr] : j) {                                \
+           const json_value& member = *member_ptr;                        \
+           EXPAND(FROM_JSON_DISPATCH(__VA_ARGS__))                        \
+       }                                                                  \
+       return value;                                                      \
+    }                                                                     \
+    Template inline Type from_jv_impl(const json_value& jv, Type* _) {    \
+       return from_jv_impl(jv.get_object(), (Type*) 0);                   \
+    }                                                                     \
+    Template inline Type from_jv_impl(const json_node& node, Type* _) {   \
+       Type value;                                                        \
+       for (auto [key, member] : node.members()) {                        \
+           EXPAND(FROM_JSON_DISPATCH(__VA_ARGS__))                        \
+       }                                                                  \
+       return value;                                                      \
+    }                                                                     \
+    Template inline vector<Type> from_jv_columns(const json& j, vector<Type>* _) {          \
+       vector<Type> values;                                                                 \
+       for (auto& [key, column] : j) {                                                      \
+           switch (json_key_hash(key)) {                                                    \
+               EXPAND(PASTE(FROM_JSON_COLUMN_CASE, __VA_ARGS__))                            \
+               default: break;                                                              \
+           }                                                                                \
+       }                                                                                    \
+       return values;                                                                       \
+    }                                                                                       \
+    Template inline vector<Type> from_jv_columns(const json_node& node, vector<Type>* _) {  \
+       vector<Type> values;                                                                 \
+       for (auto [key, column] : node.members()) {                                          \
+           switch (json_key_hash(key)) {                                                    \
+               EXPAND(PASTE(FROM_JSON_COLUMN_CASE, __VA_ARGS__))                            \
+               default: break;                                                              \
+           }                                                                                \
+       }                                                                                    \
+       return values;                                                                       \
     }
 
+#define FROM_JSON_IMPL(Type, ...) FROM_JSON_IMPL_TEMPLATE(, Type, __VA_ARGS__)
+
 #define TO_JSON_ELE(var) \
         j[#var] = make_shared<json_value>(to_jv(value.var));
 
 #define TO_JSON_MEMBER(var) \
     j[#var] = make_shared<json_value>(to_jv(var));
 
-#define TO_JSON_IMPL(Type, ...)                  \
-    inline json_value to_jv(const Type& value) { \
-        auto j = json();                         \
-        EXPAND(PASTE(TO_JSON_ELE, __VA_ARGS__))  \
-        return to_jv(j);                         \
+#define WRITE_JSON_ELE(var)    \
+    writer.write_key(#var);    \
+    write_jv(writer, value.var);
+
+#define JSON_MEMBER_NAME_ELE(var) name == #var ||
+
+#define TO_JSON_COLUMN(var)                                                  \
+    {                                                                        \
+        vector<json_value> column;                                           \
+        column.reserve(values.size());                                       \
+        for (const auto& element : values)                                   \
+            column.push_back(to_jv(element.var));                            \
+        j[#var] = make_shared<json_value>(to_jv(std::move(column)));         \
     }
 
+#define WRITE_JSON_COLUMN(var)                  \
+    writer.write_key(#var);                     \
+    writer.begin_list();                        \
+    for (const auto& element : values)          \
+        write_jv(writer, element.var);          \
+    writer.end_list();
+
+// write_jv_members writes the fields without braces so callers can append their own alongside
+#define TO_JSON_IMPL_TEMPLATE(Template, Type, ...)                                  \
+    Template inline json_value to_jv(const Type& value) {                           \
+        auto j = json();                                                            \
+        EXPAND(PASTE(TO_JSON_ELE, __VA_ARGS__))                                     \
+        return to_jv(j);                                                            \
+    }                                                                               \
+    Template inline void write_jv_members(json_writer& writer, const Type& value) { \
+        EXPAND(PASTE(WRITE_JSON_ELE, __VA_ARGS__))                                  \
+    }                                                                               \
+    Template inline void write_jv(json_writer& writer, const Type& value) {         \
+        writer.begin_object();                                                      \
+        write_jv_members(writer, value);                                            \
+        writer.end_object();                                                        \
+    }                                                                               \
+    Template inline bool json_has_member(const Type* _, string_view name) {         \
+        return EXPAND(PASTE(JSON_MEMBER_NAME_ELE, __VA_ARGS__)) false;              \
+    }                                                                               \
+    Template inline json_value to_jv_columns(const vector<Type>& values) {          \
+        auto j = json();                                                            \
+        if (values.empty())                                                         \
+            return to_jv(j);                                                        \
+        EXPAND(PASTE(TO_JSON_COLUMN, __VA_ARGS__))                                  \
+        return to_jv(j);                                                            \
+    }                                                                               \
+    Template inline void write_jv_columns(json_writer& writer, const vector<Type>& values) { \
+        EXPAND(PASTE(WRITE_JSON_COLUMN, __VA_ARGS__))                               \
+    }
+
+#define TO_JSON_IMPL(Type, ...) TO_JSON_IMPL_TEMPLATE(, Type, __VA_ARGS__)
+
 #define JSON_IMPL(Type, ...)          \
     FROM_JSON_IMPL(Type, __VA_ARGS__) \
     TO_JSON_IMPL(Type, __VA_ARGS__)
 
-#define JSON_IMPL_TEMPLATE(Template, Type, ...) \
-Template FROM_JSON_IMPL(Type, __VA_ARGS__)      \
-Template TO_JSON_IMPL(Type, __VA_ARGS__)
+#define JSON_IMPL_TEMPLATE(Template, Type, ...)         \
+FROM_JSON_IMPL_TEMPLATE(Template, Type, __VA_ARGS__)    \
+TO_JSON_IMPL_TEMPLATE(Template, Type, __VA_ARGS__)
+
+// Writes a vector of a JSON_IMPL struct as one list per member, or a umap as parallel "keys" and "values" lists,
+// instead of an object per element. Use on the container type (alias maps with commas), at namespace spellbook scope.
+#define JSON_COLUMNAR(Type) \
+template <> struct json_columnar<Type> : std::true_type {};
@@ -0,0 +1,249 @@
+#include "json_binary.hpp"
+
+#include <cmath>
+#include <cstring>
+
+namespace spellbook {
+
+static void write_varint(vector<uint8>& out, uint64 value) {
+    while (value >= 0x80) {
+        out.push_back(uint8(value) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(uint8(value));
+}
+
+static void write_bytes(vector<uint8>& out, const void* data, uint64 size) {
+    uint32 offset = out.size();
+    out.resize(offset + size);
+    memcpy(out.data() + offset, data, size);
+}
+
+struct json_binary_encoder {
+    vector<uint8>&      out;
+    umap<json_key, uint32> key_indices;
+    vector<json_key>       keys;
+
+    // Keys are gathered up front so the table can precede the values
+    void gather_keys(const json& j) {
+        for (auto& [key, value] : j) {
+            if (key_indices.try_emplace(key, keys.size()).second)
+                keys.push_back(key);
+            gather_keys(*value);
+        }
+    }
+    void gather_keys(const json_value& jv) {
+        if (const json* j = std::get_if<json>(&jv.value))
+            gather_keys(*j);
+        else if (const vector<json_value>* list = std::get_if<vector<json_value>>(&jv.value))
+            for (const json_value& e : *list)
+                gather_keys(e);
+    }
+
+    void write(const json& j) {
+        out.push_back(json_binary_object);
+        write_varint(out, j.size());
+        for (auto& [key, value] : j) {
+            write_varint(out, key_indices[key]);
+            write(*value);
+        }
+    }
+    void write(const json_value& jv) {
+        std::visit(overloaded {
+                [&](const json& a) { write(a); },
+                [&](const vector<json_value>& a) {
+                    out.push_back(json_binary_list);
+                    write_varint(out, a.size());
+                    for (const json_value& e : a)
+                        write(e);
+                },
+                [&](const string& a) {
+                    out.push_back(json_binary_string);
+                    write_varint(out, a.size());
+                    write_bytes(out, a.data(), a.size());
+                },
+                [&](bool a) { out.push_back(a ? json_binary_true : json_binary_false); },
+                [&](int64 a) {
+                    out.push_back(json_binary_int);
+                    write_varint(out, (uint64(a) << 1) ^ uint64(a >> 63));
+                },
+                [&](double a) {
+                    if (a == std::trunc(a) && std::abs(a) < 9007199254740992.0 && !std::signbit(a)) {
+                        out.push_back(json_binary_double_as_int);
+                        write_varint(out, uint64(a));
+                    } else if (double(float(a)) == a) {
+                        float f = float(a);
+                        out.push_back(json_binary_double_as_float);
+                        write_bytes(out, &f, sizeof(float));
+                    } else {
+                        out.push_back(json_binary_double);
+                        write_bytes(out, &a, sizeof(double));
+                    }
+                }
+            },
+            jv.value);
+    }
+};
+
+bool is_json_binary(span<const uint8> data) {
+    if (data.size() < sizeof(json_binary_header))
+        return false;
+    uint32 magic;
+    memcpy(&magic, data.data(), sizeof(uint32));
+    return magic == json_binary_header::magic_value;
+}
+
+void write_json_binary(const json& j, vector<uint8>& out) {
+    json_binary_encoder encoder{out};
+    encoder.gather_keys(j);
+
+    json_binary_header header = {json_binary_header::magic_value, json_binary_header::current_version, encoder.keys.size()};
+    write_bytes(out, &header, sizeof(json_binary_header));
+    for (const json_key& key : encoder.keys) {
+        write_varint(out, key.str().size());
+        write_bytes(out, key.str().data(), key.str().size());
+    }
+    encoder.write(j);
+}
+
+struct json_binary_decoder {
+    const uint8*   cur;
+    const uint8*   end;
+    vector<json_key> keys;
+    bool           failed = false;
+    uint32         depth  = 0;
+
+    uint64 read_varint() {
+        uint64 value = 0;
+        for (uint32 shift = 0; shift < 64; shift += 7) {
+            if (cur >= end)
+                break;
+            uint8 byte = *cur++;
+            value |= uint64(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                return value;
+        }
+        failed = true;
+        return 0;
+    }
+
+    // Same limit as the text parsers
+    bool enter() {
+        if (++depth <= json_reader::max_depth)
+            return true;
+        failed = true;
+        return false;
+    }
+
+    // Counts and lengths are checked against what's left so corrupt files can't trigger huge allocations
+    bool has(uint64 size) {
+        if (uint64(end - cur) >= size)
+            return true;
+        failed = true;
+        return false;
+    }
+
+    json read_object_body() {
+        json   j;
+        uint64 count = read_varint();
+        if (!has(count))
+            return j;
+        j.reserve(count);
+        for (uint64 i = 0; i < count && !failed; i++) {
+            uint64 key_index = read_varint();
+            if (key_index >= keys.size()) {
+                failed = true;
+                break;
+            }
+            j[keys[key_index]] = make_shared<json_value>(read_value());
+        }
+        return j;
+    }
+
+    json_value read_value() {
+        if (!has(1))
+            return {};
+        switch (*cur++) {
+            case json_binary_null: return {};
+            case json_binary_false: return json_value{json_variant{false}};
+            case json_binary_true: return json_value{json_variant{true}};
+            case json_binary_int: {
+                uint64 zigzag = read_varint();
+                return json_value{json_variant{int64(zigzag >> 1) ^ -int64(zigzag & 1)}};
+            }
+            case json_binary_double: {
+                double value = 0.0;
+                if (has(sizeof(double))) {
+                    memcpy(&value, cur, sizeof(double));
+                    cur += sizeof(double);
+                }
+                return json_value{json_variant{value}};
+            }
+            case json_binary_double_as_int: return json_value{json_variant{double(read_varint())}};
+            case json_binary_double_as_float: {
+                float value = 0.0f;
+                if (has(sizeof(float))) {
+                    memcpy(&value, cur, sizeof(float));
+                    cur += sizeof(float);
+                }
+                return json_value{json_variant{double(value)}};
+            }
+            case json_binary_string: {
+                uint64 size = read_varint();
+                if (!has(size))
+                    return {};
+                string value((const char*) cur, size);
+                cur += size;
+                return json_value{json_variant{std::move(value)}};
+            }
+            case json_binary_list: {
+                uint64 count = read_varint();
+                vector<json_value> list;
+                if (!has(count) || !enter())
+                    return {};
+                list.reserve(count);
+                for (uint64 i = 0; i < count && !failed; i++)
+                    list.push_back(read_value());
+                depth--;
+                return json_value{json_variant{std::move(list)}};
+            }
+            case json_binary_object: {
+                if (!enter())
+                    return {};
+                json_value value{json_variant{read_object_body()}};
+                depth--;
+                return value;
+            }
+            default: failed = true;
+        }
+        return {};
+    }
+};
+
+bool read_json_binary(span<const uint8> data, json& j) {
+    if (!is_json_binary(data))
+        return false;
+    json_binary_header header;
+    memcpy(&header, data.data(), sizeof(json_binary_header));
+    if (header.version != json_binary_header::current_version)
+        return false;
+
+    json_binary_decoder decoder{data.data() + sizeof(json_binary_header), data.data() + data.size()};
+    if (!decoder.has(header.key_count))
+        return false;
+    decoder.keys.reserve(header.key_count);
+    for (uint32 i = 0; i < header.key_count && !decoder.failed; i++) {
+        uint64 size = decoder.read_varint();
+        if (!decoder.has(size))
+            break;
+        decoder.keys.push_back(json_key::intern(string_view((const char*) decoder.cur, size)));
+        decoder.cur += size;
+    }
+
+    if (!decoder.has(1) || *decoder.cur++ != json_binary_object)
+        return false;
+    j = decoder.read_object_body();
+    return !decoder.failed;
+}
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "general/file/json.hpp"
+
+namespace spellbook {
+
+// Binary form of the json data model. Every distinct key is stored once in a table after the header, objects refer
+// to keys by index. Containers are prefixed with their element count, integers are zigzag varints.
+struct json_binary_header {
+    static constexpr uint32 magic_value = 0x424a4253; // "SBJB"
+    static constexpr uint32 current_version = 1;
+
+    uint32 magic;
+    uint32 version;
+    uint32 key_count;
+};
+
+enum json_binary_tag : uint8 {
+    json_binary_null,
+    json_binary_false,
+    json_binary_true,
+    json_binary_int,
+    json_binary_double,
+    json_binary_string,
+    json_binary_list,
+    json_binary_object,
+    // doubles that survive the round trip are stored smaller, they still decode as doubles
+    json_binary_double_as_int,
+    json_binary_double_as_float
+};
+
+bool is_json_binary(span<const uint8> data);
+void write_json_binary(const json& j, vector<uint8>& out);
+bool read_json_binary(span<const uint8> data, json& j);
+
+}
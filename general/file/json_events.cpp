@@ -0,0 +1,100 @@
+#include "json_events.hpp"
+
+#include "general/vector.hpp"
+#include "general/file/file_view.hpp"
+#include "general/file/json_reader.hpp"
+
+namespace spellbook {
+
+bool parse_events(string_view source, json_handler& handler) {
+    json_reader reader(source);
+    reader.skip_bom();
+    reader.skip_whitespace();
+    if (reader.at_end())
+        return true;
+
+    // open containers, '}' or ']', kept on the heap so deep documents can't blow the stack
+    vector<char> closers;
+    string scratch;
+    // only right after an open can the container close without a value first
+    bool just_opened = false;
+    while (!reader.failed) {
+        reader.skip_whitespace();
+        if (just_opened && reader.consume(closers.last())) {
+            closers.last() == '}' ? handler.end_object() : handler.end_list();
+            closers.remove_back();
+        } else {
+            if (!closers.empty() && closers.last() == '}') {
+                handler.key(reader.read_string(scratch));
+                reader.skip_whitespace();
+                if (!reader.consume(':'))
+                    reader.fail("expected ':'");
+                if (reader.failed)
+                    break;
+                reader.skip_whitespace();
+            }
+            switch (reader.peek()) {
+                case '{': {
+                    reader.consume('{');
+                    handler.begin_object();
+                    closers.push_back('}');
+                    just_opened = true;
+                    continue;
+                }
+                case '[': {
+                    reader.consume('[');
+                    handler.begin_list();
+                    closers.push_back(']');
+                    just_opened = true;
+                    continue;
+                }
+                case '"': handler.string_value(reader.read_string(scratch)); break;
+                case 't':
+                case 'f': {
+                    if (reader.read_literal("true"))
+                        handler.bool_value(true);
+                    else if (reader.read_literal("false"))
+                        handler.bool_value(false);
+                    else
+                        reader.fail("expected value");
+                } break;
+                case 'n': {
+                    if (reader.read_literal("null"))
+                        handler.null_value();
+                    else
+                        reader.fail("expected value");
+                } break;
+                default: {
+                    json_number number = reader.read_number();
+                    if (reader.failed)
+                        break;
+                    if (number.is_int)
+                        handler.int_value(number.int_value);
+                    else
+                        handler.double_value(number.double_value);
+                }
+            }
+        }
+        just_opened = false;
+
+        // a value just ended, what follows is a ',' before the next one or the closers of finished containers
+        while (!closers.empty() && !reader.failed && !reader.next_or_close(closers.last())) {
+            if (reader.failed)
+                break;
+            closers.last() == '}' ? handler.end_object() : handler.end_list();
+            closers.remove_back();
+        }
+        if (closers.empty())
+            break;
+    }
+    return !reader.failed;
+}
+
+bool parse_events_file(const string& file_name, json_handler& handler) {
+    FileView file(file_name);
+    if (!file.opened)
+        return false;
+    return parse_events(file.view(), handler);
+}
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "general/string.hpp"
+
+namespace spellbook {
+
+// Receives values in document order without a tree being built. Views only live for the duration of the call.
+struct json_handler {
+    virtual ~json_handler() = default;
+
+    virtual void begin_object() {}
+    virtual void end_object() {}
+    virtual void begin_list() {}
+    virtual void end_list() {}
+    virtual void key(string_view key) {}
+
+    virtual void string_value(string_view value) {}
+    virtual void int_value(int64 value) {}
+    virtual void double_value(double value) {}
+    virtual void bool_value(bool value) {}
+    virtual void null_value() {}
+};
+
+// Returns false on malformed input, events up to the error will already have been sent
+bool parse_events(string_view source, json_handler& handler);
+bool parse_events_file(const string& file_name, json_handler& handler);
+
+}
@@ -0,0 +1,95 @@
+#include "json_key.hpp"
+
+#include <shared_mutex>
+
+#include "general/umap.hpp"
+#include "general/memory.hpp"
+
+namespace spellbook {
+
+struct json_key_table {
+    std::shared_mutex mutex;
+    // views point into the entries, which never move or die
+    umap<string_view, unique_ptr<json_key_entry>> entries;
+};
+
+static json_key_table& get_key_table() {
+    static json_key_table table;
+    return table;
+}
+
+static const json_key_entry empty_key_entry = {string(), hash_view({})};
+
+// Parsing threads would all contend on the table's lock for every key, each keeps its own copy of what it has
+// looked up instead. Entries never die, so neither do the cached pointers. It's cleared when it gets big, a thread
+// that sees a lot of distinct keys shouldn't hold its own copy of the table.
+constexpr uint64 local_entry_limit = 4096;
+static thread_local umap<string_view, const json_key_entry*> local_entries;
+
+static void cache_locally(const json_key_entry* entry) {
+    if (local_entries.size() >= local_entry_limit)
+        local_entries.clear();
+    local_entries.emplace(string_view(entry->str), entry);
+}
+
+const json_key_entry* json_key::_find(string_view key) {
+    if (key.empty())
+        return &empty_key_entry;
+    if (auto local_it = local_entries.find(key); local_it != local_entries.end())
+        return local_it->second;
+
+    json_key_table& table = get_key_table();
+    const json_key_entry* found = nullptr;
+    {
+        std::shared_lock lock(table.mutex);
+        auto it = table.entries.find(key);
+        if (it == table.entries.end())
+            return nullptr;
+        found = it->second.get();
+    }
+    cache_locally(found);
+    return found;
+}
+
+const json_key_entry* json_key::_intern(string_view key) {
+    if (const json_key_entry* existing = _find(key))
+        return existing;
+
+    json_key_table& table = get_key_table();
+    const json_key_entry* found = nullptr;
+    {
+        std::unique_lock lock(table.mutex);
+        auto it = table.entries.find(key);
+        if (it == table.entries.end()) {
+            auto new_entry = make_unique<json_key_entry>(json_key_entry{string(key), hash_view(key)});
+            string_view stored = new_entry->str;
+            it = table.entries.emplace(stored, std::move(new_entry)).first;
+        }
+        found = it->second.get();
+    }
+    cache_locally(found);
+    return found;
+}
+
+json_key::json_key() : entry(&empty_key_entry) {}
+
+json_key::json_key(string_view key) {
+    entry = _find(key);
+    // nothing stored can equal it, a key that's in a json was interned before it got there
+    if (entry == nullptr)
+        entry = new json_key_entry{string(key), hash_view(key), false};
+}
+
+json_key json_key::intern(string_view key) {
+    json_key interned;
+    interned.entry = _intern(key);
+    return interned;
+}
+
+uint64 json_key_count() {
+    json_key_table& table = get_key_table();
+    std::shared_lock lock(table.mutex);
+    return table.entries.size();
+}
+
+}
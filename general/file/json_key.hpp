@@ -0,0 +1,77 @@
+#pragma once
+
+#include <utility>
+
+#include <robin_hood.h>
+
+#include "general/string.hpp"
+#include "general/hash.hpp"
+
+namespace spellbook {
+
+struct json_key_entry {
+    string str;
+    uint64 hash; // hash_view of str
+    // false for a string that was only looked up, the json_key holding it owns it
+    bool interned = true;
+};
+
+// Interned object key. Equal keys share one entry for the lifetime of the program, so comparing is a pointer
+// compare and hashing reads the precomputed hash. Converts implicitly to and from strings.
+// Converting a string only looks it up, so a find or contains that misses doesn't grow the table. A string that
+// was never interned is interned once the key is copied or moved, which is how it gets stored in a json.
+struct json_key {
+    const json_key_entry* entry;
+
+    json_key();
+    json_key(string_view key);
+    json_key(const string& key) : json_key(string_view(key)) {}
+    json_key(const char* key) : json_key(string_view(key)) {}
+    json_key(const json_key& other) : entry(other.entry->interned ? other.entry : _intern(other.entry->str)) {}
+    json_key(json_key&& other) noexcept : json_key(std::as_const(other)) {}
+    json_key& operator=(const json_key& other) {
+        const json_key_entry* stored = other.entry->interned ? other.entry : _intern(other.entry->str);
+        _release();
+        entry = stored;
+        return *this;
+    }
+    json_key& operator=(json_key&& other) noexcept { return *this = std::as_const(other); }
+    ~json_key() { _release(); }
+
+    // For keys that are about to be stored, skips the lookup only key
+    static json_key intern(string_view key);
+
+    operator const string&() const { return entry->str; }
+    const string& str() const { return entry->str; }
+    string_view   view() const { return entry->str; }
+    uint64        hash() const { return entry->hash; }
+
+    bool operator==(const json_key& other) const {
+        return entry == other.entry || (!(entry->interned && other.entry->interned) && entry->str == other.entry->str);
+    }
+    bool operator!=(const json_key& other) const { return !(*this == other); }
+
+    static const json_key_entry* _find(string_view key);
+    static const json_key_entry* _intern(string_view key);
+    void _release() {
+        if (!entry->interned)
+            delete entry;
+    }
+};
+
+// Lets code that handles both json and json_node keys stay generic
+inline string_view json_key_view(string_view key) { return key; }
+inline string_view json_key_view(const json_key& key) { return key.view(); }
+inline uint64      json_key_hash(string_view key) { return hash_view(key); }
+inline uint64      json_key_hash(const json_key& key) { return key.hash(); }
+
+uint64 json_key_count();
+
+}
+
+template <>
+struct robin_hood::hash<spellbook::json_key> {
+    size_t operator()(const spellbook::json_key& key) const noexcept {
+        return key.hash();
+    }
+};
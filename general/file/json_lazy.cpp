@@ -0,0 +1,100 @@
+#include "json_lazy.hpp"
+
+#include "general/file/file_view.hpp"
+#include "general/file/json_reader.hpp"
+#include "general/file/json_binary.hpp"
+
+namespace spellbook {
+
+const json_value* lazy_json::get(const json_key& key) {
+    auto it = members.find(key);
+    if (it == members.end())
+        return nullptr;
+    member& m = it->second;
+    if (m.parsed == nullptr)
+        m.parsed = make_shared<json_value>(parse_item(source.substr(m.start, m.end - m.start)));
+    return m.parsed.get();
+}
+
+json lazy_json::materialize() {
+    json j;
+    j.reserve(members.size());
+    for (auto& [key, m] : members) {
+        get(key);
+        j.emplace(key, m.parsed);
+    }
+    return j;
+}
+
+void lazy_json::copy_source() {
+    auto owned = make_shared<const string>(source);
+    source = *owned;
+    owned_source = std::move(owned);
+}
+
+static lazy_json parse_lazy_source(shared_ptr<const void> owner, string_view source) {
+    lazy_json lazy;
+    lazy.owned_source = std::move(owner);
+    lazy.source = source;
+
+    // binary files are already cheap to decode in full, their members just start out parsed
+    span<const uint8> bytes((const uint8*) source.data(), source.size());
+    if (is_json_binary(bytes)) {
+        json j;
+        lazy.failed = !read_json_binary(bytes, j);
+        for (auto& [key, value] : j)
+            lazy.members[key].parsed = value;
+        return lazy;
+    }
+
+    json_reader reader(source);
+    reader.skip_bom();
+    reader.skip_whitespace();
+    if (reader.at_end())
+        return lazy;
+    if (!reader.consume('{')) {
+        reader.fail("expected object");
+        lazy.failed = true;
+        return lazy;
+    }
+
+    string scratch;
+    reader.skip_whitespace();
+    bool empty = reader.consume('}');
+    while (!empty && !reader.failed) {
+        reader.skip_whitespace();
+        json_key key = json_key::intern(reader.read_string(scratch));
+        reader.skip_whitespace();
+        if (!reader.consume(':'))
+            reader.fail("expected ':'");
+        reader.skip_whitespace();
+        uint32 start = reader.offset();
+        reader.skip_value();
+        if (reader.offset() == start)
+            reader.fail("expected value");
+        if (reader.failed)
+            break;
+        // first occurrence of a duplicate key wins, same as parse
+        lazy.members.try_emplace(key, lazy_json::member{start, uint32(reader.offset())});
+        if (!reader.next_or_close('}'))
+            break;
+    }
+    lazy.failed = reader.failed;
+    return lazy;
+}
+
+lazy_json parse_lazy(string contents) {
+    auto owned = make_shared<const string>(std::move(contents));
+    string_view source = *owned;
+    return parse_lazy_source(std::move(owned), source);
+}
+
+lazy_json parse_lazy_file(const string& file_name) {
+    auto file = make_shared<FileView>(file_name);
+    if (!file->opened)
+        return {};
+    string_view source = file->view();
+    return parse_lazy_source(std::move(file), source);
+}
+
+}
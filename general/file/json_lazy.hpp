@@ -0,0 +1,34 @@
+#pragma once
+
+#include "general/file/json.hpp"
+
+namespace spellbook {
+
+// Top level object whose member values are only located up front. A member is parsed the first time it's asked
+// for, so reading a couple of fields out of a large file costs a structural scan instead of a full parse.
+struct lazy_json {
+    struct member {
+        uint32 start = 0;
+        uint32 end   = 0;
+        shared_ptr<json_value> parsed;
+    };
+
+    // string or mapped file that source points into
+    shared_ptr<const void>   owned_source;
+    string_view              source;
+    umap<json_key, member>   members;
+    bool failed = false;
+
+    bool contains(const json_key& key) const { return members.contains(key); }
+    // nullptr when missing, parses the member on first access
+    const json_value* get(const json_key& key);
+    // Parses whatever hasn't been yet and hands back the whole object
+    json materialize();
+    // Points source at a copy instead of the mapped file, for keeping it past the file being written again
+    void copy_source();
+};
+
+lazy_json parse_lazy(string contents);
+lazy_json parse_lazy_file(const string& file_name);
+
+}
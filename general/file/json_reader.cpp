@@ -0,0 +1,307 @@
+#include "json_reader.hpp"
+
+#include <bit>
+#include <charconv>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define JSON_READER_SSE2
+#endif
+
+namespace spellbook {
+
+json_reader::json_reader(string_view source) : start(source.data()), cur(source.data()), end(source.data() + source.size()) {}
+
+bool json_reader::consume(char c) {
+    if (cur < end && *cur == c) {
+        cur++;
+        return true;
+    }
+    return false;
+}
+
+bool json_reader::next_or_close(char close) {
+    skip_whitespace();
+    if (consume(','))
+        return true;
+    if (!consume(close))
+        fail(close == '}' ? "expected ',' or '}'" : "expected ',' or ']'");
+    return false;
+}
+
+void json_reader::skip_bom() {
+    if (end - cur >= 3 && uint8(cur[0]) == 0xEF && uint8(cur[1]) == 0xBB && uint8(cur[2]) == 0xBF)
+        cur += 3;
+}
+
+void json_reader::fail(const char* reason) {
+    if (!failed)
+        error = {reason, uint64(cur - start)};
+    failed = true;
+    cur = end;
+}
+
+bool json_reader::enter() {
+    if (++depth <= max_depth)
+        return true;
+    fail("nested too deep");
+    return false;
+}
+
+static bool is_whitespace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f';
+}
+
+void json_reader::skip_whitespace() {
+    // Most tokens are separated by nothing or by a single space
+    if (cur >= end || !is_whitespace(*cur))
+        return;
+    cur++;
+#ifdef JSON_READER_SSE2
+    // Indentation runs are long enough to be worth 16 bytes at a time
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i carriage = _mm_set1_epi8('\r');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i form_feed = _mm_set1_epi8('\f');
+    while (end - cur >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*) cur);
+        __m128i whitespace = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, newline)),
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, carriage), _mm_cmpeq_epi8(chunk, tab)), _mm_cmpeq_epi8(chunk, form_feed)));
+        uint32 other = ~uint32(_mm_movemask_epi8(whitespace)) & 0xFFFF;
+        if (other != 0) {
+            cur += std::countr_zero(other);
+            return;
+        }
+        cur += 16;
+    }
+#endif
+    while (cur < end && is_whitespace(*cur))
+        cur++;
+}
+
+// Position of the next quote or backslash, or end
+static const char* find_string_special(const char* cur, const char* end) {
+#ifdef JSON_READER_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    while (end - cur >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*) cur);
+        uint32 special = uint32(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash))));
+        if (special != 0)
+            return cur + std::countr_zero(special);
+        cur += 16;
+    }
+#endif
+    while (cur < end && *cur != '"' && *cur != '\\')
+        cur++;
+    return cur;
+}
+
+static bool read_hex4(const char*& cur, const char* end, uint32& out) {
+    if (end - cur < 4)
+        return false;
+    out = 0;
+    for (int32 i = 0; i < 4; i++) {
+        char c = *cur++;
+        out <<= 4;
+        if (c >= '0' && c <= '9')
+            out |= c - '0';
+        else if (c >= 'a' && c <= 'f')
+            out |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            out |= c - 'A' + 10;
+        else
+            return false;
+    }
+    return true;
+}
+
+static void append_utf8(string& out, uint32 code_point) {
+    if (code_point < 0x80) {
+        out.push_back(char(code_point));
+    } else if (code_point < 0x800) {
+        out.push_back(char(0xC0 | (code_point >> 6)));
+        out.push_back(char(0x80 | (code_point & 0x3F)));
+    } else if (code_point < 0x10000) {
+        out.push_back(char(0xE0 | (code_point >> 12)));
+        out.push_back(char(0x80 | ((code_point >> 6) & 0x3F)));
+        out.push_back(char(0x80 | (code_point & 0x3F)));
+    } else {
+        out.push_back(char(0xF0 | (code_point >> 18)));
+        out.push_back(char(0x80 | ((code_point >> 12) & 0x3F)));
+        out.push_back(char(0x80 | ((code_point >> 6) & 0x3F)));
+        out.push_back(char(0x80 | (code_point & 0x3F)));
+    }
+}
+
+string_view json_reader::read_string(string& scratch) {
+    if (!consume('"')) {
+        fail("expected string");
+        return {};
+    }
+    return read_string_body(scratch);
+}
+
+string_view json_reader::read_string_body(string& scratch) {
+    const char* string_start = cur;
+    const char* special = find_string_special(cur, end);
+    if (special >= end) {
+        fail("unterminated string");
+        return {};
+    }
+    if (*special == '"') {
+        cur = special + 1;
+        return string_view(string_start, special - string_start);
+    }
+
+    scratch.assign(string_start, special);
+    cur = special;
+    while (cur < end) {
+        char c = *cur++;
+        if (c == '"')
+            return string_view(scratch);
+        if (c != '\\') {
+            const char* next = find_string_special(cur, end);
+            scratch.push_back(c);
+            scratch.append(cur, next);
+            cur = next;
+            continue;
+        }
+        if (cur >= end)
+            break;
+        char escaped = *cur++;
+        switch (escaped) {
+            case 'n': scratch.push_back('\n'); break;
+            case 't': scratch.push_back('\t'); break;
+            case 'r': scratch.push_back('\r'); break;
+            case 'b': scratch.push_back('\b'); break;
+            case 'f': scratch.push_back('\f'); break;
+            case 'u': {
+                uint32 code_point;
+                if (!read_hex4(cur, end, code_point)) {
+                    fail("bad unicode escape");
+                    return {};
+                }
+                if (code_point >= 0xD800 && code_point < 0xDC00 && end - cur >= 6 && cur[0] == '\\' && cur[1] == 'u') {
+                    const char* low_start = cur + 2;
+                    uint32 low;
+                    if (read_hex4(low_start, end, low) && low >= 0xDC00 && low < 0xE000) {
+                        code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                        cur = low_start;
+                    }
+                }
+                append_utf8(scratch, code_point);
+            } break;
+            // quote, backslash, slash, and anything unknown is taken literally
+            default: scratch.push_back(escaped);
+        }
+    }
+    fail("unterminated string");
+    return {};
+}
+
+json_number json_reader::read_number() {
+    const char* number_start = cur;
+    bool is_int = true;
+    while (cur < end) {
+        char c = *cur;
+        if (c == '.' || c == 'e' || c == 'E')
+            is_int = false;
+        else if (!(c >= '0' && c <= '9') && c != '-' && c != '+')
+            break;
+        cur++;
+    }
+
+    json_number number = {true, 0, 0.0};
+    if (is_int) {
+        auto [ptr, ec] = std::from_chars(number_start, cur, number.int_value);
+        if (ec == std::errc() && ptr == cur)
+            return number;
+        // out of range integers fall through to double
+    }
+    number.is_int = false;
+    auto [ptr, ec] = std::from_chars(number_start, cur, number.double_value);
+    if (ec != std::errc() || ptr != cur)
+        fail(cur == number_start ? "expected value" : "bad number");
+    return number;
+}
+
+void json_reader::skip_string_body() {
+    while (true) {
+        cur = find_string_special(cur, end);
+        if (cur >= end) {
+            fail("unterminated string");
+            return;
+        }
+        if (*cur++ == '"')
+            return;
+        // escaped character, whatever it is, unless the input ends on the backslash
+        if (cur >= end) {
+            fail("unterminated string");
+            return;
+        }
+        cur++;
+    }
+}
+
+// Position of the next quote or bracket, or end
+static const char* find_structural(const char* cur, const char* end) {
+#ifdef JSON_READER_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    // '[' and ']' differ from '{' and '}' only in bit 0x20, so those four are found with two compares
+    const __m128i fold = _mm_set1_epi8(0x20);
+    const __m128i open = _mm_set1_epi8('{');
+    const __m128i close = _mm_set1_epi8('}');
+    while (end - cur >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*) cur);
+        __m128i folded = _mm_or_si128(chunk, fold);
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_or_si128(_mm_cmpeq_epi8(folded, open), _mm_cmpeq_epi8(folded, close)));
+        uint32 mask = uint32(_mm_movemask_epi8(hits));
+        if (mask != 0)
+            return cur + std::countr_zero(mask);
+        cur += 16;
+    }
+#endif
+    while (cur < end && *cur != '"' && *cur != '{' && *cur != '}' && *cur != '[' && *cur != ']')
+        cur++;
+    return cur;
+}
+
+void json_reader::skip_value() {
+    skip_whitespace();
+    char c = peek();
+    if (c == '"') {
+        cur++;
+        skip_string_body();
+    } else if (c == '{' || c == '[') {
+        uint32 depth = 0;
+        while (!failed) {
+            cur = find_structural(cur, end);
+            if (cur >= end) {
+                fail("unterminated container");
+                return;
+            }
+            char d = *cur++;
+            if (d == '"')
+                skip_string_body();
+            else if (d == '{' || d == '[')
+                depth++;
+            else if (--depth == 0)
+                return;
+        }
+    } else {
+        while (cur < end && *cur != ',' && *cur != '}' && *cur != ']' && !is_whitespace(*cur))
+            cur++;
+    }
+}
+
+bool json_reader::read_literal(string_view literal) {
+    if (uint64(end - cur) < literal.size() || string_view(cur, literal.size()) != literal)
+        return false;
+    cur += literal.size();
+    return true;
+}
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "general/string.hpp"
+
+namespace spellbook {
+
+struct json_number {
+    bool   is_int;
+    int64  int_value;
+    double double_value;
+};
+
+// Why and where a parse stopped, reason is null when it didn't
+struct json_error {
+    const char* reason = nullptr;
+    uint64      offset = 0;
+
+    explicit operator bool() const { return reason != nullptr; }
+};
+
+// Cursor over a contiguous JSON buffer, holds the scanning primitives the parsers share.
+// The buffer has to outlive the reader and any views it returns.
+struct json_reader {
+    const char* start;
+    const char* cur;
+    const char* end;
+    bool        failed = false;
+    json_error  error;
+
+    // Containers nested deeper than this fail instead of recursing further
+    static constexpr uint32 max_depth = 256;
+    uint32 depth = 0;
+
+    explicit json_reader(string_view source);
+
+    bool   at_end() const { return cur >= end; }
+    char   peek() const { return cur < end ? *cur : '\0'; }
+    uint64 offset() const { return cur - start; }
+
+    bool consume(char c);
+    // After a member or element, true when a ',' says another follows and false once close is consumed.
+    // Anything else fails.
+    bool next_or_close(char close);
+    void skip_bom();
+    void skip_whitespace();
+    // Only the first failure is recorded, the cursor moves to the end so every loop stops
+    void fail(const char* reason = "malformed json");
+    // Call when opening a container, false (and failed) once max_depth is passed
+    bool enter();
+    void leave() { depth--; }
+
+    // Expects the opening quote. No escapes returns a view into the buffer, otherwise the string is decoded into scratch.
+    string_view read_string(string& scratch);
+    // Same, but the opening quote has already been consumed
+    string_view read_string_body(string& scratch);
+    // Numbers without fraction or exponent that fit in an int64 are integers
+    json_number read_number();
+    bool        read_literal(string_view literal);
+
+    // Moves past one value without decoding it, only string boundaries and nesting are tracked
+    void skip_value();
+    void skip_string_body();
+};
+
+}
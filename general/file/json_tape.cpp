@@ -0,0 +1,202 @@
+#include "json_tape.hpp"
+
+#include <cstring>
+
+#include "general/file/file_view.hpp"
+#include "general/file/json_reader.hpp"
+
+namespace spellbook {
+
+char* json_arena::allocate(uint32 size) {
+    // big strings get a block to themselves, the current one stays open
+    if (size > block_size / 4) {
+        allocated_bytes += size;
+        return blocks.emplace_back(make_unique<char[]>(size)).get();
+    }
+    if (size > remaining) {
+        head = blocks.emplace_back(make_unique<char[]>(block_size)).get();
+        remaining = block_size;
+        allocated_bytes += block_size;
+    }
+    char* result = head;
+    head += size;
+    remaining -= size;
+    return result;
+}
+
+json_node json_list_iterator::operator*() const {
+    return json_node{node};
+}
+
+std::pair<string_view, json_node> json_member_iterator::operator*() const {
+    return {string_view(key->str, key->size), json_node{key + 1}};
+}
+
+string_view json_node::get_string() const {
+    if (type() != json_tape_string)
+        return {};
+    return string_view(node->str, node->size);
+}
+
+int64 json_node::get_int() const {
+    switch (type()) {
+        case json_tape_int: return node->int_value;
+        case json_tape_double: return int64(node->double_value);
+        default: return 0;
+    }
+}
+
+double json_node::get_double() const {
+    switch (type()) {
+        case json_tape_double: return node->double_value;
+        case json_tape_int: return double(node->int_value);
+        default: return 0.0;
+    }
+}
+
+bool json_node::get_bool() const {
+    return type() == json_tape_bool && node->bool_value;
+}
+
+json_node json_node::find(string_view key) const {
+    if (!is_object())
+        return {};
+    for (auto [member_key, value] : members()) {
+        if (member_key == key)
+            return value;
+    }
+    return {};
+}
+
+json_node json_node::at(uint32 index) const {
+    if (!is_list() || index >= node->size)
+        return {};
+    const json_tape_node* element = node + 1;
+    for (uint32 i = 0; i < index; i++)
+        element += element->skip;
+    return json_node{element};
+}
+
+json_range<json_list_iterator> json_node::elements() const {
+    if (!is_list())
+        return {};
+    return {json_list_iterator{node + 1}, json_list_iterator{node + node->skip}};
+}
+
+json_range<json_member_iterator> json_node::members() const {
+    if (!is_object())
+        return {};
+    return {json_member_iterator{node + 1}, json_member_iterator{node + node->skip}};
+}
+
+static void push_string(json_document& document, json_reader& reader, string& scratch) {
+    string_view view = reader.read_string(scratch);
+    json_tape_node& node = document.tape.emplace_back();
+    node.type = json_tape_string;
+    node.size = view.size();
+    node.skip = 1;
+    // escape free strings already view the source
+    if (view.data() == scratch.data() && !view.empty()) {
+        char* copy = document.arena.allocate(view.size());
+        memcpy(copy, view.data(), view.size());
+        node.str = copy;
+    } else {
+        node.str = view.data();
+    }
+}
+
+static void push_value(json_document& document, json_reader& reader, string& scratch) {
+    reader.skip_whitespace();
+    char c = reader.peek();
+    if (c == '"') {
+        push_string(document, reader, scratch);
+        return;
+    }
+
+    uint32 index = document.tape.size();
+    json_tape_node& node = document.tape.emplace_back();
+    node.skip = 1;
+    node.size = 0;
+    node.int_value = 0;
+
+    if (c == '{' || c == '[') {
+        reader.consume(c);
+        if (!reader.enter())
+            return;
+        bool   is_object = c == '{';
+        char   close     = is_object ? '}' : ']';
+        uint32 count     = 0;
+        node.type = is_object ? json_tape_object : json_tape_list;
+        reader.skip_whitespace();
+        bool empty = reader.consume(close);
+        while (!empty && !reader.failed) {
+            if (is_object) {
+                reader.skip_whitespace();
+                push_string(document, reader, scratch);
+                reader.skip_whitespace();
+                if (!reader.consume(':'))
+                    reader.fail("expected ':'");
+            }
+            push_value(document, reader, scratch);
+            count++;
+            if (!reader.next_or_close(close))
+                break;
+        }
+        // the tape may have grown, node is stale
+        document.tape[index].size = count;
+        document.tape[index].skip = document.tape.size() - index;
+        reader.leave();
+    } else if (reader.read_literal("true") || reader.read_literal("false")) {
+        node.type = json_tape_bool;
+        node.bool_value = c == 't';
+    } else if (reader.read_literal("null")) {
+        node.type = json_tape_null;
+    } else {
+        json_number number = reader.read_number();
+        if (number.is_int) {
+            node.type = json_tape_int;
+            node.int_value = number.int_value;
+        } else {
+            node.type = json_tape_double;
+            node.double_value = number.double_value;
+        }
+    }
+}
+
+json_document parse_document(string_view source) {
+    json_document document;
+    // a node per 8 bytes of source is roughly what dense resources come to
+    document.tape.reserve(source.size() / 8 + 1);
+
+    json_reader reader(source);
+    reader.skip_bom();
+    reader.skip_whitespace();
+    if (!reader.at_end()) {
+        string scratch;
+        push_value(document, reader, scratch);
+    }
+    document.failed = reader.failed;
+    document.error = reader.error;
+    return document;
+}
+
+json_document parse_document_owned(string source) {
+    auto owned = make_shared<const string>(std::move(source));
+    json_document document = parse_document(*owned);
+    document.source_bytes = owned->size();
+    document.owned_source = std::move(owned);
+    return document;
+}
+
+json_document parse_document_file(const string& file_name) {
+    auto file = make_shared<FileView>(file_name);
+    if (!file->opened)
+        return {};
+
+    json_document document = parse_document(file->view());
+    document.source_bytes = file->size;
+    document.owned_source = std::move(file);
+    return document;
+}
+
+}
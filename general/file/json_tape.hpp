@@ -0,0 +1,116 @@
+#pragma once
+
+#include "general/vector.hpp"
+#include "general/string.hpp"
+#include "general/memory.hpp"
+#include "general/file/json_reader.hpp"
+
+namespace spellbook {
+
+enum json_tape_type : uint32 {
+    json_tape_null,
+    json_tape_object,
+    json_tape_list,
+    json_tape_string,
+    json_tape_int,
+    json_tape_double,
+    json_tape_bool
+};
+
+// One value on the tape. Containers are followed by their children, objects alternate key and value nodes,
+// skip is the number of nodes in this subtree so the next sibling is always this + skip.
+struct json_tape_node {
+    json_tape_type type : 4;
+    uint32         size : 28; // members for objects, elements for lists, bytes for strings
+    uint32         skip;
+    union {
+        const char* str;
+        int64       int_value;
+        double      double_value;
+        bool        bool_value;
+    };
+};
+
+// Stable bump allocator for strings that had to be unescaped
+struct json_arena {
+    static constexpr uint32 block_size = 64 * 1024;
+
+    vector<unique_ptr<char[]>> blocks;
+    char*  head            = nullptr;
+    uint32 remaining       = 0;
+    uint64 allocated_bytes = 0;
+
+    char* allocate(uint32 size);
+};
+
+struct json_node;
+
+template <typename It>
+struct json_range {
+    It first;
+    It last;
+    It begin() const { return first; }
+    It end() const { return last; }
+};
+
+struct json_list_iterator {
+    const json_tape_node* node;
+
+    json_node operator*() const;
+    json_list_iterator& operator++() { node += node->skip; return *this; }
+    bool operator!=(const json_list_iterator& other) const { return node != other.node; }
+};
+
+struct json_member_iterator {
+    const json_tape_node* key;
+
+    std::pair<string_view, json_node> operator*() const;
+    json_member_iterator& operator++() { key += 1 + key[1].skip; return *this; }
+    bool operator!=(const json_member_iterator& other) const { return key != other.key; }
+};
+
+// Read only view of a value on a tape, null when a lookup misses
+struct json_node {
+    const json_tape_node* node = nullptr;
+
+    explicit operator bool() const { return node != nullptr; }
+    json_tape_type type() const { return node ? node->type : json_tape_null; }
+    bool is_object() const { return type() == json_tape_object; }
+    bool is_list() const { return type() == json_tape_list; }
+    bool is_string() const { return type() == json_tape_string; }
+    uint32 size() const { return node ? node->size : 0; }
+
+    string_view get_string() const;
+    int64       get_int() const;
+    double      get_double() const;
+    bool        get_bool() const;
+
+    json_node find(string_view key) const;
+    bool      contains(string_view key) const { return bool(find(key)); }
+    json_node at(uint32 index) const;
+
+    json_range<json_list_iterator>   elements() const;
+    json_range<json_member_iterator> members() const;
+};
+
+// Whole document on one flat tape. Strings without escapes view the source, which the document either borrows
+// or owns depending on how it was parsed.
+struct json_document {
+    vector<json_tape_node> tape;
+    json_arena             arena;
+    // string or mapped file the tape points into, when the document keeps it alive itself
+    shared_ptr<const void> owned_source;
+    uint64 source_bytes = 0;
+    bool failed = false;
+    json_error error;
+
+    json_node root() const { return tape.empty() ? json_node{} : json_node{tape.data()}; }
+    uint64    memory_usage() const { return tape.bsize() + arena.allocated_bytes + source_bytes; }
+};
+
+// source has to outlive the document
+json_document parse_document(string_view source);
+json_document parse_document_owned(string source);
+json_document parse_document_file(const string& file_name);
+
+}
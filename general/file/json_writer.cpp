@@ -0,0 +1,156 @@
+#include "json_writer.hpp"
+
+#include <charconv>
+#include <filesystem>
+#include <dtoa/dtoa.h>
+
+namespace fs = std::filesystem;
+
+namespace spellbook {
+
+json_writer::~json_writer() {
+    close_file();
+}
+
+bool json_writer::open_file(const string& file_name) {
+    close_file();
+    std::error_code ec;
+    fs::create_directories(fs::path(file_name).parent_path(), ec);
+    file = fopen(file_name.c_str(), "wb");
+    return file != nullptr;
+}
+
+bool json_writer::close_file() {
+    if (file == nullptr)
+        return true;
+    flush();
+    bool ok = ferror(file) == 0;
+    ok &= fclose(file) == 0;
+    file = nullptr;
+    return ok;
+}
+
+void json_writer::flush() {
+    if (file == nullptr || out.empty())
+        return;
+    fwrite(out.data(), 1, out.size(), file);
+    out.clear();
+}
+
+void json_writer::_separate() {
+    if (file != nullptr && out.size() >= flush_size)
+        flush();
+    // values sit right after their key
+    if (after_key) {
+        after_key = false;
+        return;
+    }
+    if (needs_comma)
+        out.push_back(',');
+    needs_comma = true;
+    if (pretty && depth > 0)
+        _newline();
+}
+
+void json_writer::_newline() {
+    out.push_back('\n');
+    out.append(depth * indent, ' ');
+}
+
+void json_writer::begin_object() {
+    _separate();
+    out.push_back('{');
+    needs_comma = false;
+    depth++;
+}
+
+void json_writer::end_object() {
+    depth--;
+    // needs_comma is only set once something was written inside
+    if (pretty && needs_comma)
+        _newline();
+    out.push_back('}');
+    needs_comma = true;
+}
+
+void json_writer::begin_list() {
+    _separate();
+    out.push_back('[');
+    needs_comma = false;
+    depth++;
+}
+
+void json_writer::end_list() {
+    depth--;
+    if (pretty && needs_comma)
+        _newline();
+    out.push_back(']');
+    needs_comma = true;
+}
+
+void json_writer::write_key(string_view key) {
+    _separate();
+    _write_quoted(key);
+    out.append(pretty ? ": " : ":");
+    after_key = true;
+}
+
+void json_writer::write_string(string_view value) {
+    _separate();
+    _write_quoted(value);
+}
+
+void json_writer::write_int(int64 value) {
+    _separate();
+    char buffer[24];
+    auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, end);
+}
+
+void json_writer::write_double(double value) {
+    _separate();
+    char buffer[32];
+    int  size = dtoa(value, buffer);
+    out.append(buffer, size);
+}
+
+void json_writer::write_bool(bool value) {
+    _separate();
+    out.append(value ? "true" : "false");
+}
+
+void json_writer::write_null() {
+    _separate();
+    out.append("null");
+}
+
+void json_writer::_write_quoted(string_view value) {
+    out.push_back('"');
+    // copy clean runs in one go, only specials are handled a character at a time
+    uint64 run_start = 0;
+    for (uint64 i = 0; i < value.size(); i++) {
+        char c = value[i];
+        if (c != '"' && c != '\\' && uint8(c) >= 0x20)
+            continue;
+        out.append(value.data() + run_start, i - run_start);
+        run_start = i + 1;
+        switch (c) {
+            case '"': out.append("\\\""); break;
+            case '\\': out.append("\\\\"); break;
+            case '\n': out.append("\\n"); break;
+            case '\r': out.append("\\r"); break;
+            case '\t': out.append("\\t"); break;
+            case '\b': out.append("\\b"); break;
+            case '\f': out.append("\\f"); break;
+            default: {
+                constexpr const char* hex = "0123456789abcdef";
+                char escaped[6] = {'\\', 'u', '0', '0', hex[uint8(c) >> 4], hex[uint8(c) & 0xF]};
+                out.append(escaped, 6);
+            }
+        }
+    }
+    out.append(value.data() + run_start, value.size() - run_start);
+    out.push_back('"');
+}
+
+}
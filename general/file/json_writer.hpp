@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdio>
+
+#include "general/string.hpp"
+
+namespace spellbook {
+
+// Appends JSON text to one buffer. Commas are placed automatically, so callers only describe the structure.
+// With a file open the buffer is flushed whenever it fills, so large documents are never held whole.
+struct json_writer {
+    static constexpr uint64 flush_size = 64 * 1024;
+
+    string out;
+    FILE*  file = nullptr;
+
+    // Puts every member and element on its own indented line
+    bool   pretty = false;
+    uint32 indent = 4;
+
+    bool   needs_comma = false;
+    bool   after_key   = false;
+    uint32 depth       = 0;
+
+    json_writer() = default;
+    explicit json_writer(bool pretty) : pretty(pretty) {}
+    json_writer(const json_writer&) = delete;
+    json_writer& operator=(const json_writer&) = delete;
+    ~json_writer();
+
+    // Creates parent directories, returns false if the file can't be opened
+    bool open_file(const string& file_name);
+    // Flushes and closes the file, false if any write failed
+    bool close_file();
+    void flush();
+
+    void begin_object();
+    void end_object();
+    void begin_list();
+    void end_list();
+
+    void write_key(string_view key);
+    void write_string(string_view value);
+    void write_int(int64 value);
+    void write_double(double value);
+    void write_bool(bool value);
+    void write_null();
+
+    void _separate();
+    void _newline();
+    void _write_quoted(string_view value);
+};
+
+}
@@ -0,0 +1,342 @@
+#include "pack.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <shared_mutex>
+
+#include "general/logger.hpp"
+#include "general/file/file_path.hpp"
+#include "general/file/json.hpp"
+#include "general/file/json_binary.hpp"
+
+namespace fs = std::filesystem;
+
+namespace spellbook {
+
+bool Pack::open(const string& pack_file) {
+    entries = {};
+    paths = nullptr;
+    if (!file.open(pack_file) || file.size < sizeof(PackHeader))
+        return false;
+
+    PackHeader header;
+    memcpy(&header, file.data, sizeof(PackHeader));
+    uint64 index_end = sizeof(PackHeader) + uint64(header.entry_count) * sizeof(PackEntry);
+    bool valid = header.magic == PackHeader::magic_value && header.version == PackHeader::current_version &&
+        index_end + header.path_bytes <= file.size;
+    if (!valid)
+        return false;
+
+    // the header is a multiple of 8 bytes and the mapping is page aligned, so the index can be used in place
+    auto* index = (const PackEntry*) (file.data + sizeof(PackHeader));
+    const char* index_paths = file.data + index_end;
+    for (uint32 i = 0; i < header.entry_count; i++) {
+        const PackEntry& entry = index[i];
+        // decompressed files are held in a vector, and no stream expands past pack_max_expansion
+        bool fits = uint64(entry.path_offset) + entry.path_length <= header.path_bytes &&
+            entry.offset <= file.size && entry.stored_size <= file.size - entry.offset &&
+            ((entry.compression == PackCompression_LZ && entry.size <= UINT32_MAX && entry.size / pack_max_expansion <= entry.stored_size) ||
+             (entry.compression == PackCompression_None && entry.stored_size == entry.size));
+        if (!fits)
+            return false;
+        // find is a binary search, an unsorted index or a repeated path would hide files
+        string_view entry_path(index_paths + entry.path_offset, entry.path_length);
+        if (i > 0 && string_view(index_paths + index[i - 1].path_offset, index[i - 1].path_length) >= entry_path)
+            return false;
+    }
+    entries = span<const PackEntry>(index, header.entry_count);
+    paths = index_paths;
+    return true;
+}
+
+const PackEntry* Pack::find(string_view relative) const {
+    auto it = std::lower_bound(entries.begin(), entries.end(), relative, [this](const PackEntry& entry, string_view value) {
+        return path(entry) < value;
+    });
+    if (it == entries.end() || path(*it) != relative)
+        return nullptr;
+    return &*it;
+}
+
+static void write_extra_length(vector<uint8>& out, uint64 length) {
+    while (length >= 255) {
+        out.push_back(255);
+        length -= 255;
+    }
+    out.push_back(uint8(length));
+}
+
+// A token holds the literal count and the match length past the minimum of 4, a nibble each, 15 meaning more follow
+static void write_sequence(vector<uint8>& out, span<const uint8> literals, uint64 offset, uint64 match_length) {
+    uint64 match_code = match_length - 4;
+    out.push_back(uint8(std::min<uint64>(literals.size(), 15) << 4 | std::min<uint64>(match_code, 15)));
+    if (literals.size() >= 15)
+        write_extra_length(out, literals.size() - 15);
+    out.internal.insert(out.internal.end(), literals.begin(), literals.end());
+    out.push_back(uint8(offset));
+    out.push_back(uint8(offset >> 8));
+    if (match_code >= 15)
+        write_extra_length(out, match_code - 15);
+}
+
+vector<uint8> pack_compress(span<const uint8> input) {
+    constexpr uint32 hash_bits = 16;
+    constexpr uint64 window = 65535;
+    constexpr uint32 none = ~0u;
+    vector<uint8> out;
+    out.reserve(uint32(input.size() / 2 + 16));
+    // where each 4 byte sequence was last seen
+    vector<uint32> last_seen(1u << hash_bits, none);
+
+    uint64 anchor = 0;
+    uint64 at = 0;
+    while (at + 4 <= input.size()) {
+        uint32 sequence;
+        memcpy(&sequence, input.data() + at, 4);
+        uint32 hash = (sequence * 2654435761u) >> (32 - hash_bits);
+        uint32 candidate = last_seen[hash];
+        last_seen[hash] = uint32(at);
+        if (candidate == none || at - candidate > window || memcmp(input.data() + candidate, input.data() + at, 4) != 0) {
+            at++;
+            continue;
+        }
+
+        uint64 length = 4;
+        while (at + length < input.size() && input[candidate + length] == input[at + length])
+            length++;
+        write_sequence(out, input.subspan(anchor, at - anchor), at - candidate, length);
+        at += length;
+        anchor = at;
+    }
+
+    // the stream ends with a sequence of only literals
+    span<const uint8> literals = input.subspan(anchor);
+    out.push_back(uint8(std::min<uint64>(literals.size(), 15) << 4));
+    if (literals.size() >= 15)
+        write_extra_length(out, literals.size() - 15);
+    out.internal.insert(out.internal.end(), literals.begin(), literals.end());
+    return out;
+}
+
+static bool read_extra_length(span<const uint8> input, uint64& at, uint64& length) {
+    uint8 byte;
+    do {
+        if (at >= input.size())
+            return false;
+        byte = input[at++];
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+bool pack_decompress(span<const uint8> input, span<uint8> out) {
+    uint64 in_at = 0;
+    uint64 out_at = 0;
+    while (in_at < input.size()) {
+        uint8 token = input[in_at++];
+        uint64 literal_length = token >> 4;
+        if (literal_length == 15 && !read_extra_length(input, in_at, literal_length))
+            return false;
+        if (literal_length > input.size() - in_at || literal_length > out.size() - out_at)
+            return false;
+        memcpy(out.data() + out_at, input.data() + in_at, literal_length);
+        in_at += literal_length;
+        out_at += literal_length;
+        if (in_at == input.size())
+            break;
+
+        if (input.size() - in_at < 2)
+            return false;
+        uint64 offset = input[in_at] | uint64(input[in_at + 1]) << 8;
+        in_at += 2;
+        uint64 match_length = (token & 15) + 4;
+        if ((token & 15) == 15 && !read_extra_length(input, in_at, match_length))
+            return false;
+        if (offset == 0 || offset > out_at || match_length > out.size() - out_at)
+            return false;
+        // the match can overlap what it's writing, that's how runs repeat
+        uint8* to = out.data() + out_at;
+        const uint8* from = to - offset;
+        for (uint64 i = 0; i < match_length; i++)
+            to[i] = from[i];
+        out_at += match_length;
+    }
+    return out_at == out.size();
+}
+
+static bool write_all(FILE* f, const void* data, uint64 size) {
+    return size == 0 || fwrite(data, 1, size, f) == size;
+}
+
+PackResult write_pack(const string& source_dir, const string& pack_file, const PackOptions& options) {
+    PackResult result;
+    struct source_file {
+        string relative;
+        fs::path path;
+    };
+    vector<source_file> sources;
+    std::error_code error;
+    for (const fs::directory_entry& entry : fs::recursive_directory_iterator(source_dir, error)) {
+        std::error_code same_error;
+        if (!entry.is_regular_file() || fs::equivalent(entry.path(), pack_file, same_error))
+            continue;
+        string relative = fs::relative(entry.path(), source_dir).generic_string();
+        sources.push_back({std::move(relative), entry.path()});
+    }
+    std::sort(sources.begin(), sources.end(), [](const source_file& a, const source_file& b) { return a.relative < b.relative; });
+
+    vector<PackEntry> entries;
+    string paths;
+    for (const source_file& source : sources) {
+        entries.push_back({.path_offset = uint32(paths.size()), .path_length = uint32(source.relative.size())});
+        paths += source.relative;
+    }
+
+    FILE* f = fopen(pack_file.c_str(), "wb");
+    if (f == nullptr)
+        return result;
+    // the index is written again at the end, once the offsets are known
+    PackHeader header = {PackHeader::magic_value, PackHeader::current_version, entries.size(), uint32(paths.size())};
+    bool ok = write_all(f, &header, sizeof(PackHeader));
+    ok = ok && write_all(f, entries.data(), entries.bsize());
+    ok = ok && write_all(f, paths.data(), paths.size());
+    uint64 at = sizeof(PackHeader) + entries.bsize() + paths.size();
+
+    static const uint8 padding[pack_alignment] = {};
+    for (uint32 i = 0; i < sources.size() && ok; i++) {
+        FileView source(sources[i].path.string());
+        if (!source.opened) {
+            log_warning("Can't read " + sources[i].path.string() + " for the pack");
+            ok = false;
+            break;
+        }
+        span<const uint8> bytes = source.bytes();
+        vector<uint8> converted;
+        if (options.binary_json && sources[i].relative.find(".sbj") != string::npos && !is_json_binary(bytes)) {
+            json_error parse_error;
+            json j = parse(source.view(), &parse_error);
+            if (!parse_error) {
+                write_json_binary(j, converted);
+                bytes = span<const uint8>(converted.data(), converted.size());
+            }
+        }
+
+        PackEntry& entry = entries[i];
+        entry.size = bytes.size();
+        entry.compression = PackCompression_None;
+        vector<uint8> compressed;
+        // only kept when it's worth decompressing
+        if (options.compress && bytes.size() > 64) {
+            compressed = pack_compress(bytes);
+            if (compressed.size() < bytes.size() - bytes.size() / 8) {
+                bytes = span<const uint8>(compressed.data(), compressed.size());
+                entry.compression = PackCompression_LZ;
+            }
+        }
+
+        uint64 aligned = (at + pack_alignment - 1) / pack_alignment * pack_alignment;
+        ok &= write_all(f, padding, aligned - at);
+        entry.offset = aligned;
+        entry.stored_size = bytes.size();
+        ok &= write_all(f, bytes.data(), bytes.size());
+        at = aligned + bytes.size();
+        result.bytes_in += source.size;
+    }
+
+    ok = ok && fseek(f, 0, SEEK_SET) == 0;
+    ok = ok && write_all(f, &header, sizeof(PackHeader));
+    ok = ok && write_all(f, entries.data(), entries.bsize());
+    ok = ok && write_all(f, paths.data(), paths.size());
+    ok &= fclose(f) == 0;
+    if (!ok) {
+        fs::remove(pack_file, error);
+        return result;
+    }
+    result.written = true;
+    result.files = entries.size();
+    result.bytes_out = at;
+    return result;
+}
+
+// Later mounts are searched first
+static std::shared_mutex packs_mutex;
+static vector<shared_ptr<Pack>> mounted_packs;
+// Taken when mounting, looking it up while opening a file could end up opening the config through here
+static string mounted_content_dir;
+
+bool mount_pack(const string& pack_file, bool loose_override) {
+    auto pack = make_shared<Pack>();
+    bool opened = pack->open(pack_file);
+    check_else(opened)
+        return false;
+    pack->loose_override = loose_override;
+    string content_dir = get_content_dir_path();
+    std::unique_lock lock(packs_mutex);
+    mounted_content_dir = std::move(content_dir);
+    mounted_packs.insert(0, std::move(pack));
+    return true;
+}
+
+void unmount_packs() {
+    // open views keep their pack alive
+    std::unique_lock lock(packs_mutex);
+    mounted_packs.clear();
+}
+
+// Content relative path of an absolute file name, false when it isn't in the content directory
+static bool content_relative(const string& file_name, string_view& relative) {
+    if (!file_name.starts_with(mounted_content_dir))
+        return false;
+    relative = string_view(file_name).substr(mounted_content_dir.size());
+    return true;
+}
+
+bool open_packed(const string& file_name, FileView& view, bool before_loose) {
+    std::shared_lock lock(packs_mutex);
+    string_view relative;
+    if (mounted_packs.empty() || !content_relative(file_name, relative))
+        return false;
+
+    for (const shared_ptr<Pack>& pack : mounted_packs) {
+        if (before_loose == pack->loose_override)
+            continue;
+        const PackEntry* entry = pack->find(relative);
+        if (entry == nullptr)
+            continue;
+
+        view.close();
+        const uint8* stored = (const uint8*) pack->file.data + entry->offset;
+        if (entry->compression == PackCompression_None) {
+            view.data  = (const char*) stored;
+            view.owner = pack;
+        } else {
+            // open checked the size fits
+            auto decompressed = make_shared<vector<uint8>>(uint32(entry->size), uint8(0));
+            bool decoded = pack_decompress(span<const uint8>(stored, entry->stored_size), span<uint8>(decompressed->data(), decompressed->size()));
+            check_else(decoded)
+                return false;
+            view.data  = (const char*) decompressed->data();
+            view.owner = decompressed;
+        }
+        view.size   = entry->size;
+        view.opened = true;
+        return true;
+    }
+    return false;
+}
+
+bool packed_file_exists(const string& file_name) {
+    std::shared_lock lock(packs_mutex);
+    string_view relative;
+    if (mounted_packs.empty() || !content_relative(file_name, relative))
+        return false;
+    for (const shared_ptr<Pack>& pack : mounted_packs) {
+        if (pack->find(relative) != nullptr)
+            return true;
+    }
+    return false;
+}
+
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <memory>
+
+#include "general/vector.hpp"
+#include "general/string.hpp"
+#include "general/file/file_view.hpp"
+
+namespace spellbook {
+
+// Many content files in one, read through a single mapping. The header is followed by the index, sorted by path so
+// a lookup is a binary search, then the paths, then each file's bytes starting on a pack_alignment boundary.
+struct PackHeader {
+    static constexpr uint32 magic_value = 0x4b504253; // "SBPK"
+    static constexpr uint32 current_version = 1;
+
+    uint32 magic;
+    uint32 version;
+    uint32 entry_count;
+    uint32 path_bytes;
+};
+
+enum PackCompression : uint32 {
+    PackCompression_None,
+    PackCompression_LZ
+};
+
+struct PackEntry {
+    uint32 path_offset;
+    uint32 path_length;
+    uint64 offset;
+    uint64 stored_size;
+    uint64 size;
+    PackCompression compression;
+    uint32 reserved;
+};
+
+// So the binary formats can be read in place
+constexpr uint64 pack_alignment = 16;
+
+struct Pack {
+    FileView file;
+    span<const PackEntry> entries;
+    const char* paths = nullptr;
+    // When set, a loose file in the content directory is read instead of the pack's copy
+    bool loose_override = true;
+
+    // False if the file isn't a pack, its index doesn't fit in it or isn't sorted, or a size is impossible
+    bool open(const string& pack_file);
+    string_view path(const PackEntry& entry) const { return string_view(paths + entry.path_offset, entry.path_length); }
+    const PackEntry* find(string_view relative) const;
+};
+
+struct PackOptions {
+    bool compress = false;
+    // .sbj* files are stored in the binary json encoding
+    bool binary_json = false;
+};
+
+struct PackResult {
+    bool   written = false;
+    uint32 files = 0;
+    uint64 bytes_in = 0;
+    uint64 bytes_out = 0;
+};
+
+// Packs every file under source_dir, by its path relative to it
+PackResult write_pack(const string& source_dir, const string& pack_file, const PackOptions& options = {});
+
+// Makes the pack's files readable as content, wherever the content directory's files are opened through FileView.
+// Loose files win over the pack's copy only with loose_override, so a shipped build doesn't look for them at all.
+bool mount_pack(const string& pack_file, bool loose_override = true);
+void unmount_packs();
+// Opens a content file from the mounted packs. before_loose asks only the packs that loose files don't override.
+bool open_packed(const string& file_name, FileView& view, bool before_loose);
+bool packed_file_exists(const string& file_name);
+
+// LZ77 with a 64 KiB window, byte oriented so decoding is just copies. Every input byte adds at most 255 output bytes.
+constexpr uint64 pack_max_expansion = 255;
+vector<uint8> pack_compress(span<const uint8> input);
+// out has to be exactly the original size
+bool pack_decompress(span<const uint8> input, span<uint8> out);
+
+}
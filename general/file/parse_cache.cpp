@@ -0,0 +1,141 @@
+#include "parse_cache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+
+#include "extension/fmt.hpp"
+#include "general/hash.hpp"
+#include "general/logger.hpp"
+#include "general/file/file_view.hpp"
+#include "general/file/json_binary.hpp"
+
+namespace fs = std::filesystem;
+
+namespace spellbook {
+
+ParseCache& get_parse_cache() {
+    static ParseCache parse_cache;
+    return parse_cache;
+}
+
+static FilePath cache_folder() {
+    return FilePath("parse_cache/", FilePathLocation_Config);
+}
+
+FilePath ParseCache::entry_path(const FilePath& file_path) const {
+    uint64 path_hash = hash_combine(hash_view(file_path.value), uint64(file_path.location));
+    return FilePath(fmt_("parse_cache/{:016x}.sbjcache", path_hash), FilePathLocation_Config);
+}
+
+void ParseCache::clear() {
+    std::error_code error;
+    fs::remove_all(cache_folder().abs_path(), error);
+}
+
+bool ParseCache::_read_entry(const FilePath& file_path, uint64 size, int64 modified, json& j) {
+    FileView entry(entry_path(file_path).abs_string());
+    if (!entry.opened || entry.size < sizeof(ParseCacheHeader))
+        return false;
+
+    ParseCacheHeader header;
+    memcpy(&header, entry.data, sizeof(ParseCacheHeader));
+    uint64 payload_start = sizeof(ParseCacheHeader) + header.path_length;
+    bool valid = header.magic == ParseCacheHeader::magic_value && header.version == ParseCacheHeader::current_version &&
+        header.binary_version == json_binary_header::current_version && header.size == size && payload_start <= entry.size &&
+        entry.view().substr(sizeof(ParseCacheHeader), header.path_length) == file_path.value;
+    if (!valid)
+        return false;
+
+    bool touched = header.modified != modified;
+    if (touched) {
+        // touched, checked out again, or copied, but maybe not changed
+        FileView source(file_path.abs_string());
+        if (!source.opened || hash_view(source.view()) != header.content_hash)
+            return false;
+        rehashes++;
+    }
+
+    if (!read_json_binary(entry.bytes().subspan(payload_start), j))
+        return false;
+    if (touched) {
+        // only the header needs to catch up, the entry is still replaced whole so other readers never see it half written
+        header.modified = modified;
+        vector<uint8> out;
+        out.internal.assign(entry.bytes().begin(), entry.bytes().end());
+        memcpy(out.data(), &header, sizeof(ParseCacheHeader));
+        // windows can't rename over a mapped file
+        entry.close();
+        _replace_entry(file_path, out);
+    }
+    return true;
+}
+
+void ParseCache::_write_entry(const FilePath& file_path, uint64 size, int64 modified, uint64 content_hash, const json& j) {
+    ParseCacheHeader header = {
+        .magic          = ParseCacheHeader::magic_value,
+        .version        = ParseCacheHeader::current_version,
+        .binary_version = json_binary_header::current_version,
+        .path_length    = uint32(file_path.value.size()),
+        .size           = size,
+        .modified       = modified,
+        .content_hash   = content_hash
+    };
+    vector<uint8> out;
+    out.append_data(header);
+    out.internal.insert(out.internal.end(), file_path.value.begin(), file_path.value.end());
+    vector<uint8> binary;
+    write_json_binary(j, binary);
+    out.append(binary);
+    _replace_entry(file_path, out);
+}
+
+void ParseCache::_replace_entry(const FilePath& file_path, const vector<uint8>& out) {
+    // written aside then renamed over, so a reader never sees half an entry
+    string entry = entry_path(file_path).abs_string();
+    string temporary = fmt_("{}.{}.tmp", entry, std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    create_directories(cache_folder());
+    FILE* f = fopen(temporary.c_str(), "wb");
+    if (f == nullptr)
+        return;
+    bool written = fwrite(out.data(), 1, out.size(), f) == out.size();
+    fclose(f);
+    std::error_code error;
+    if (written)
+        fs::rename(temporary, entry, error);
+    if (!written || error)
+        fs::remove(temporary, error);
+}
+
+json ParseCache::load(const FilePath& file_path) {
+    string file_name = file_path.abs_string();
+    std::error_code error;
+    uint64 size = fs::file_size(file_name, error);
+    int64 modified = error ? 0 : fs::last_write_time(file_name, error).time_since_epoch().count();
+    if (!enabled || error)
+        return parse_file(file_name);
+
+    json j;
+    if (_read_entry(file_path, size, modified, j)) {
+        hits++;
+        return j;
+    }
+    misses++;
+
+    FileView source(file_name);
+    // binary files are already as fast to read as an entry would be
+    if (!source.opened || is_json_binary(source.bytes()))
+        return parse_file(file_name);
+
+    json_error parse_error;
+    j = parse(source.view(), &parse_error);
+    if (parse_error) {
+        log_warning(fmt_("Malformed json: {}, {} at byte {}", file_name, parse_error.reason, parse_error.offset));
+        return j;
+    }
+    _write_entry(file_path, size, modified, hash_view(source.view()), j);
+    return j;
+}
+
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+
+#include "general/file/json.hpp"
+#include "general/file/file_path.hpp"
+
+namespace spellbook {
+
+// Entries start with this, the json's binary form follows
+struct ParseCacheHeader {
+    static constexpr uint32 magic_value = 0x43504253; // "SBPC"
+    // Bump when the entry layout changes. The binary format's version is checked too, so changes there don't need it.
+    static constexpr uint32 current_version = 1;
+
+    uint32 magic;
+    uint32 version;
+    uint32 binary_version;
+    // the source's relative path follows the header, it's checked in case two paths share an entry
+    uint32 path_length;
+    uint64 size;
+    int64  modified;
+    uint64 content_hash;
+};
+
+// Parsed jsons kept in the config directory in the binary format, so files that haven't changed since the last run
+// skip parsing. An entry is used when the file's size and modification time still match. When only the time moved,
+// the content is hashed and the entry is used if that matches. Safe to use from any thread.
+struct ParseCache {
+    bool enabled = true;
+
+    std::atomic<uint64> hits    = 0;
+    // hits that had to hash the file because its time changed
+    std::atomic<uint64> rehashes = 0;
+    std::atomic<uint64> misses  = 0;
+
+    // Same as parse_file, but read back from the cache when the file hasn't changed
+    json load(const FilePath& file_path);
+    FilePath entry_path(const FilePath& file_path) const;
+    void clear();
+
+    bool _read_entry(const FilePath& file_path, uint64 size, int64 modified, json& j);
+    void _write_entry(const FilePath& file_path, uint64 size, int64 modified, uint64 content_hash, const json& j);
+    void _replace_entry(const FilePath& file_path, const vector<uint8>& out);
+};
+
+ParseCache& get_parse_cache();
+
+}
@@ -41,6 +41,11 @@ bool inspect_dependencies(vector<FilePath>& dependencies, const FilePath& curren
     return changed;
 }
 
+vector<ResourceCacheHooks>& resource_cache_hooks() {
+    static vector<ResourceCacheHooks> hooks;
+    return hooks;
+}
+
 FilePath get_resource_folder() { return "resources"_content; }
 FilePath get_external_resource_folder() { return "external"_content; }
 FilePath resource_path(string_view val) { return get_resource_folder() + string(val); }
@@ -39,23 +39,64 @@ struct Directory {
     static function<bool(const FilePath&)> path_filter() { return [](const FilePath& path) { return path.is_directory(); }; }
 };
 
+// Every resource type's cache hooks itself in here, so a changed file can be reloaded wherever it's cached
+struct ResourceCacheHooks {
+    function<bool(const FilePath&)> contains;
+    function<void(const FilePath&)> reload;
+};
+vector<ResourceCacheHooks>& resource_cache_hooks();
+
+template <typename T>
+void reload_resource(const FilePath& file_path);
+
 template <typename T>
 umap<FilePath, unique_ptr<T>>& cpu_resource_cache() {
     static umap<FilePath, unique_ptr<T>> t_cache;
+    [[maybe_unused]] static bool hooked = (resource_cache_hooks().push_back({
+        [](const FilePath& file_path) { return cpu_resource_cache<T>().contains(file_path); },
+        [](const FilePath& file_path) { reload_resource<T>(file_path); }
+    }), true);
     return t_cache;
 }
 
+// JSON_IMPL types decode straight from the parsed json, hand written from_jv_impl ones go through a json_value
 template <typename T>
-bool save_resource(const T& resource_value) {
-    auto j = from_jv<json>(to_jv(resource_value));
-    j["dependencies"] = make_shared<json_value>(to_jv(resource_value.dependencies));
+T resource_from_json(const json& j) {
+    if constexpr (requires { from_jv_impl(j, (T*) 0); })
+        return from_jv<T>(j);
+    else
+        return from_jv<T>(to_jv(j));
+}
 
+template <typename T>
+bool save_resource(const T& resource_value) {
     assert_else(resource_value.file_path.extension() == T::extension())
     return false;
 
-    cpu_resource_cache<T>()[resource_value.file_path] = make_unique<T>(resource_value);
-    file_dump(j, resource_value.file_path.abs_string());
-    return true;
+    if constexpr (requires (json_writer& writer) { write_jv_members(writer, resource_value); }) {
+        json_writer writer;
+        bool opened = writer.open_file(resource_value.file_path.abs_string());
+        assert_else(opened)
+        return false;
+
+        writer.begin_object();
+        write_jv_members(writer, resource_value);
+        if (!json_has_member(&resource_value, "dependencies")) {
+            writer.write_key("dependencies");
+            write_jv(writer, resource_value.dependencies);
+        }
+        writer.end_object();
+
+        cpu_resource_cache<T>()[resource_value.file_path] = make_unique<T>(resource_value);
+        return writer.close_file();
+    } else {
+        // hand written to_jv goes through a json tree
+        auto j = from_jv<json>(to_jv(resource_value));
+        j["dependencies"] = make_shared<json_value>(to_jv(resource_value.dependencies));
+        cpu_resource_cache<T>()[resource_value.file_path] = make_unique<T>(resource_value);
+        file_dump(j, resource_value.file_path.abs_string());
+        return true;
+    }
 }
 
 // Usually the ref will want to be copied
@@ -77,14 +118,30 @@ T& load_resource(const FilePath& file_path, bool assert_exists = false, bool cle
         return *cpu_resource_cache<T>().emplace(file_path, std::make_unique<T>()).first->second;
     }
 
-    json& j = get_file_cache().load_json(file_path);
+    // pinned, loading the dependencies could otherwise evict it
+    FileCachePin<json> j = get_file_cache().load_json(file_path);
 
-    T& t = *cpu_resource_cache<T>().emplace(file_path, make_unique<T>(from_jv<T>(to_jv(j)))).first->second;
-    t.dependencies = get_file_cache().load_dependencies(j);
+    T& t = *cpu_resource_cache<T>().emplace(file_path, make_unique<T>(resource_from_json<T>(*j))).first->second;
+    t.dependencies = get_file_cache().load_dependencies(*j);
     t.file_path = file_path;
     return t;
 }
 
+// Rebuilds the cached resource in place from the file cache, so references to it stay valid. Nothing happens when
+// it isn't cached, or when the file is gone and the last version is all there is.
+template <typename T>
+void reload_resource(const FilePath& file_path) {
+    auto it = cpu_resource_cache<T>().find(file_path);
+    if (it == cpu_resource_cache<T>().end() || !file_path.exists())
+        return;
+
+    FileCachePin<json> j = get_file_cache().load_json(file_path);
+    T& t = *it->second;
+    t = resource_from_json<T>(*j);
+    t.dependencies = get_file_cache().load_dependencies(*j);
+    t.file_path = file_path;
+}
+
 }
 
 namespace ImGui {
@@ -35,11 +35,19 @@ struct id_ptr {
 
 template <typename T>
 id_ptr<T> from_jv_impl(const json_value& jv, id_ptr<T>* _) {
-    json      j = from_jv<json>(jv);
+    const json& j = jv.get_object();
     if (j.contains("node"))
-        return id_ptr<T>(from_jv<T>(*j["node"]), from_jv<uint64>(*j["id"]));
+        return id_ptr<T>(from_jv<T>(*j.at("node")), from_jv<uint64>(*j.at("id")));
     else
-        return id_ptr<T>(from_jv<uint64>(*j["id"]));
+        return id_ptr<T>(from_jv<uint64>(*j.at("id")));
+}
+
+template <typename T>
+id_ptr<T> from_jv_impl(const json_node& node, id_ptr<T>* _) {
+    if (json_node inner = node.find("node"))
+        return id_ptr<T>(from_jv<T>(inner), from_jv<uint64>(node.find("id")));
+    else
+        return id_ptr<T>(from_jv<uint64>(node.find("id")));
 }
 
 template <typename T>
@@ -49,6 +57,14 @@ json_value to_jv(const id_ptr<T>& value) {
     return to_jv(j);
 }
 
+template <typename T>
+void write_jv(json_writer& writer, const id_ptr<T>& value) {
+    writer.begin_object();
+    writer.write_key("id");
+    write_jv(writer, value.id);
+    writer.end_object();
+}
+
 template <typename T>
 json_value to_jv_full(const id_ptr<T>& value) {
     auto j = json();
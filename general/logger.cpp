@@ -3,5 +3,6 @@
 namespace spellbook {
 
 std::queue<BasicMessage> message_queue;
+std::mutex message_mutex;
 
 }
@@ -1,5 +1,6 @@
 ﻿#pragma once
 
+#include <mutex>
 #include <queue>
 
 #include "general/color.hpp"
@@ -14,29 +15,45 @@ struct BasicMessage {
 };
 
 extern std::queue<BasicMessage> message_queue;
+// Logging works from any thread, whatever drains the queue locks this too
+extern std::mutex message_mutex;
 
 using namespace std::string_literals;
 
 inline void log_warning(const std::string& msg) {
+    std::lock_guard lock(message_mutex);
     message_queue.emplace("WARNING: "s + msg, "warning", palette::orange);
 }
 
 inline void log_error(const std::string& msg) {
-    message_queue.emplace("ERROR: "s + msg, "assert", palette::crimson);
+    {
+        std::lock_guard lock(message_mutex);
+        message_queue.emplace("ERROR: "s + msg, "assert", palette::crimson);
+    }
     __debugbreak();
 }
 
 inline void log_warning(const std::string& msg, const std::string& group) {
+    std::lock_guard lock(message_mutex);
     message_queue.emplace("WARNING: "s + msg, group, palette::orange);
 }
 
 inline void log_error(const std::string& msg, const std::string& group) {
-    message_queue.emplace("ERROR: "s + msg, group, palette::crimson);
+    {
+        std::lock_guard lock(message_mutex);
+        message_queue.emplace("ERROR: "s + msg, group, palette::crimson);
+    }
     __debugbreak();
     }
 
-inline void log(const BasicMessage& msg) { message_queue.push(msg); }
-inline void log(BasicMessage&& msg) { message_queue.push(msg); }
+inline void log(const BasicMessage& msg) {
+    std::lock_guard lock(message_mutex);
+    message_queue.push(msg);
+}
+inline void log(BasicMessage&& msg) {
+    std::lock_guard lock(message_mutex);
+    message_queue.push(std::move(msg));
+}
 
 #ifdef DEBUG
 #define sb_assert(cond)                                   \
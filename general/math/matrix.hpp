@@ -78,15 +78,35 @@ struct m44 {
 };
 
 inline m44 from_jv_impl(const json_value& jv, m44* _) {
-    auto vec = from_jv<vector<float>>(jv);
     m44 m;
-    std::copy_n(vec.begin(), 16, m.data);
+    int32 i = 0;
+    for (const json_value& e : jv.get_elements()) {
+        if (i >= 16)
+            break;
+        m.data[i++] = from_jv<float>(e);
+    }
+    return m;
+}
+inline m44 from_jv_impl(const json_node& node, m44* _) {
+    m44 m;
+    int32 i = 0;
+    for (json_node e : node.elements()) {
+        if (i >= 16)
+            break;
+        m.data[i++] = from_jv<float>(e);
+    }
     return m;
 }
 inline json_value to_jv(const m44& m) {
     vector<float> vec(m.data, m.data + 16);
     return to_jv(vec);
 }
+inline void write_jv(json_writer& writer, const m44& m) {
+    writer.begin_list();
+    for (float f : m.data)
+        writer.write_double(f);
+    writer.end_list();
+}
 
 struct m33 {
     float data[9] = {};
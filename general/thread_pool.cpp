@@ -0,0 +1,106 @@
+#include "thread_pool.hpp"
+
+#include <atomic>
+
+#include "general/memory.hpp"
+
+namespace spellbook {
+
+ThreadPool::ThreadPool(uint32 thread_count) {
+    if (thread_count == 0)
+        thread_count = std::max(1u, std::thread::hardware_concurrency()) - 1;
+    workers.reserve(thread_count);
+    for (uint32 i = 0; i < thread_count; i++)
+        workers.emplace_back([this] { _work(); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    job_added.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void ThreadPool::enqueue(function<void()> job) {
+    // without workers the caller does it
+    if (workers.empty()) {
+        job();
+        return;
+    }
+    {
+        std::lock_guard lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    job_added.notify_one();
+}
+
+void ThreadPool::parallel_for(uint32 count, const function<void(uint32)>& body) {
+    if (count == 0)
+        return;
+
+    // Indices are claimed one at a time, so uneven jobs still spread out. Helpers that only get to run after
+    // everything is claimed find nothing left, they keep the state alive but never touch body.
+    struct shared_state {
+        std::atomic<uint32>     next     = 0;
+        std::atomic<uint32>     finished = 0;
+        std::mutex              mutex;
+        std::condition_variable done;
+    };
+    auto state = make_shared<shared_state>();
+    auto drain = [state, &body, count] {
+        uint32 finished = 0;
+        for (uint32 i = state->next++; i < count; i = state->next++) {
+            body(i);
+            finished++;
+        }
+        if (finished > 0 && state->finished.fetch_add(finished) + finished == count) {
+            std::lock_guard lock(state->mutex);
+            state->done.notify_all();
+        }
+    };
+
+    uint32 helpers = std::min(thread_count(), count - 1);
+    for (uint32 i = 0; i < helpers; i++)
+        enqueue(drain);
+    // the caller works too, which also keeps nested calls from waiting on a busy pool
+    drain();
+
+    std::unique_lock lock(state->mutex);
+    state->done.wait(lock, [&state, count] { return state->finished == count; });
+}
+
+void ThreadPool::wait_idle() {
+    std::unique_lock lock(mutex);
+    job_finished.wait(lock, [this] { return jobs.empty() && running == 0; });
+}
+
+void ThreadPool::_work() {
+    while (true) {
+        function<void()> job;
+        {
+            std::unique_lock lock(mutex);
+            job_added.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty())
+                return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            running++;
+        }
+        job();
+        {
+            std::lock_guard lock(mutex);
+            running--;
+        }
+        job_finished.notify_all();
+    }
+}
+
+ThreadPool& get_thread_pool() {
+    static ThreadPool thread_pool;
+    return thread_pool;
+}
+
+}
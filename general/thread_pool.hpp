@@ -0,0 +1,43 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "general/vector.hpp"
+#include "general/function.hpp"
+
+namespace spellbook {
+
+// Fixed set of worker threads pulling jobs off one queue
+struct ThreadPool {
+    vector<std::thread>          workers;
+    std::deque<function<void()>> jobs;
+    std::mutex                   mutex;
+    std::condition_variable      job_added;
+    std::condition_variable      job_finished;
+    uint32                       running  = 0;
+    bool                         stopping = false;
+
+    // 0 uses one thread per core, less the calling thread
+    explicit ThreadPool(uint32 thread_count = 0);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    // Finishes the queued jobs, then joins
+    ~ThreadPool();
+
+    void enqueue(function<void()> job);
+    // Runs body(i) for every i below count on the workers and the calling thread, returns once all have finished
+    void parallel_for(uint32 count, const function<void(uint32)>& body);
+    // Blocks until the queue is empty and no job is running
+    void wait_idle();
+
+    uint32 thread_count() const { return workers.size(); }
+
+    void _work();
+};
+
+ThreadPool& get_thread_pool();
+
+}
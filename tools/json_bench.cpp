@@ -0,0 +1,214 @@
+// Measures the json parsers and writers on synthetic documents, and on real resources when given paths.
+//   json_bench [--iterations N] [file_or_dir ...]
+// Reports throughput in MB/s of source text, heap allocations per run and the peak heap growth during a run.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <new>
+
+#include "general/file/file_view.hpp"
+#include "general/file/json.hpp"
+#include "general/file/json_binary.hpp"
+#include "general/file/json_events.hpp"
+#include "general/file/json_lazy.hpp"
+
+namespace fs = std::filesystem;
+using namespace spellbook;
+
+// Every heap allocation goes through here, the size is kept in front of the block so frees can be accounted
+static uint64 allocation_count = 0;
+static uint64 live_bytes       = 0;
+static uint64 peak_bytes       = 0;
+static constexpr uint64 allocation_header = 16;
+
+void* operator new(size_t size) {
+    auto* block = (uint8*) malloc(size + allocation_header);
+    if (block == nullptr)
+        throw std::bad_alloc();
+    *(uint64*) block = size;
+    allocation_count++;
+    live_bytes += size;
+    peak_bytes = live_bytes > peak_bytes ? live_bytes : peak_bytes;
+    return block + allocation_header;
+}
+
+void operator delete(void* ptr) noexcept {
+    if (ptr == nullptr)
+        return;
+    uint8* block = (uint8*) ptr - allocation_header;
+    live_bytes -= *(uint64*) block;
+    free(block);
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void  operator delete[](void* ptr) noexcept { operator delete(ptr); }
+void  operator delete(void* ptr, size_t) noexcept { operator delete(ptr); }
+void  operator delete[](void* ptr, size_t) noexcept { operator delete(ptr); }
+
+struct bench_document {
+    string name;
+    string text;
+};
+
+struct bench_result {
+    double best_ms     = 0.0;
+    uint64 allocations = 0;
+    uint64 peak        = 0;
+};
+
+struct null_handler : json_handler {};
+
+static uint32 iterations = 5;
+
+// Best time over the iterations, allocations and peak from the first run
+template <typename F>
+static bench_result measure(F&& f) {
+    bench_result result;
+    for (uint32 i = 0; i < iterations; i++) {
+        uint64 allocations_before = allocation_count;
+        uint64 live_before = live_bytes;
+        peak_bytes = live_bytes;
+        auto start = std::chrono::steady_clock::now();
+        f();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (i == 0) {
+            result.best_ms     = ms;
+            result.allocations = allocation_count - allocations_before;
+            result.peak        = peak_bytes - live_before;
+        } else if (ms < result.best_ms) {
+            result.best_ms = ms;
+        }
+    }
+    return result;
+}
+
+static void report(const char* stage, const bench_result& result, uint64 bytes) {
+    double mb_per_s = result.best_ms > 0.0 ? (bytes / (1024.0 * 1024.0)) / (result.best_ms / 1000.0) : 0.0;
+    printf("  %-14s %9.2f ms %9.1f MB/s %10llu allocs %10.2f MB peak\n", stage, result.best_ms, mb_per_s,
+        (unsigned long long) result.allocations, result.peak / (1024.0 * 1024.0));
+}
+
+static void run(const bench_document& document) {
+    uint64 bytes = document.text.size();
+    printf("%s (%.2f MB)\n", document.name.c_str(), bytes / (1024.0 * 1024.0));
+
+    json parsed = parse(document.text);
+    vector<uint8> binary;
+    write_json_binary(parsed, binary);
+
+    report("parse", measure([&] { json j = parse(document.text); }), bytes);
+    report("tape", measure([&] { json_document d = parse_document(document.text); }), bytes);
+    report("events", measure([&] { null_handler handler; parse_events(document.text, handler); }), bytes);
+    report("lazy scan", measure([&] { lazy_json l = parse_lazy(document.text); }), bytes);
+    report("dump", measure([&] { string s = dump_json(parsed); }), bytes);
+    report("dump pretty", measure([&] { string s = dump_json(parsed, true); }), bytes);
+    report("binary write", measure([&] { vector<uint8> out; write_json_binary(parsed, out); }), bytes);
+    report("binary read", measure([&] {
+        json j;
+        read_json_binary(span<const uint8>(binary.data(), binary.size()), j);
+    }), bytes);
+}
+
+static bench_document make_deep_nesting() {
+    // stays under json_reader::max_depth, many times over so the document has some size
+    string text = "{\"levels\":[";
+    for (uint32 copy = 0; copy < 2000; copy++) {
+        if (copy > 0)
+            text += ',';
+        for (uint32 i = 0; i < 100; i++)
+            text += i % 2 == 0 ? "{\"child\":" : "[";
+        text += "0";
+        for (int32 i = 99; i >= 0; i--)
+            text += i % 2 == 0 ? "}" : "]";
+    }
+    text += "]}";
+    return {"deep nesting", std::move(text)};
+}
+
+static bench_document make_number_array() {
+    string text = "{\"ints\":[";
+    for (uint32 i = 0; i < 500000; i++)
+        text += (i > 0 ? "," : "") + std::to_string(int64(i) * 7919 - 1000000);
+    text += "],\"doubles\":[";
+    char buffer[32];
+    for (uint32 i = 0; i < 500000; i++) {
+        snprintf(buffer, sizeof(buffer), "%s%.9g", i > 0 ? "," : "", i * 0.001 - 3.75);
+        text += buffer;
+    }
+    text += "]}";
+    return {"number arrays", std::move(text)};
+}
+
+static bench_document make_small_objects() {
+    string text = "{\"objects\":[";
+    char buffer[160];
+    for (uint32 i = 0; i < 200000; i++) {
+        snprintf(buffer, sizeof(buffer), "%s{\"name\":\"object_%u\",\"x\":%u,\"scale\":%.2f,\"visible\":%s,\"tags\":[\"a\",\"b\"]}",
+            i > 0 ? "," : "", i, i % 97, (i % 13) * 0.25, i % 3 == 0 ? "true" : "false");
+        text += buffer;
+    }
+    text += "]}";
+    return {"small objects", std::move(text)};
+}
+
+// Roughly what a map resource looks like, dependencies up front then many positioned entries with nested structs
+static bench_document make_resource_shaped() {
+    string text = "{\"dependencies\":[";
+    char buffer[256];
+    for (uint32 i = 0; i < 200; i++) {
+        snprintf(buffer, sizeof(buffer), "%s\"models/tiles/tile_%u.sbjmod\"", i > 0 ? "," : "", i);
+        text += buffer;
+    }
+    text += "],\"name\":\"Generated \\\"bench\\\" map\",\"tiles\":[";
+    for (uint32 i = 0; i < 100000; i++) {
+        snprintf(buffer, sizeof(buffer),
+            "%s{\"position\":[%u,%u,%d],\"prefab\":\"models/tiles/tile_%u.sbjmod\",\"transform\":{\"rotation\":[0.0,0.0,%.4f,1.0],\"scale\":1.0}}",
+            i > 0 ? "," : "", i % 317, i / 317, int32(i % 5) - 2, i % 200, (i % 4) * 0.7071);
+        text += buffer;
+    }
+    text += "]}";
+    return {"resource shaped", std::move(text)};
+}
+
+static void add_file(vector<bench_document>& documents, const fs::path& path) {
+    FileView file(path.string());
+    if (!file.opened) {
+        printf("can't open %s\n", path.string().c_str());
+        return;
+    }
+    // binary resources are benchmarked as their text form
+    json j;
+    if (is_json_binary(file.bytes()) && read_json_binary(file.bytes(), j))
+        documents.push_back({path.string(), dump_json(j)});
+    else
+        documents.push_back({path.string(), string(file.view())});
+}
+
+int main(int argc, char** argv) {
+    vector<bench_document> documents;
+    for (int32 i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc) {
+            iterations = std::max(1, atoi(argv[++i]));
+        } else if (fs::is_directory(arg)) {
+            for (const fs::directory_entry& entry : fs::recursive_directory_iterator(arg)) {
+                if (entry.is_regular_file() && entry.path().extension().string().starts_with(".sbj"))
+                    add_file(documents, entry.path());
+            }
+        } else {
+            add_file(documents, arg);
+        }
+    }
+
+    documents.push_back(make_deep_nesting());
+    documents.push_back(make_number_array());
+    documents.push_back(make_small_objects());
+    documents.push_back(make_resource_shaped());
+
+    printf("best of %u runs\n", iterations);
+    for (const bench_document& document : documents)
+        run(document);
+    return 0;
+}
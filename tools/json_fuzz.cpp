@@ -0,0 +1,238 @@
+// Feeds malformed input to every json parser, which must neither crash nor slow down quadratically.
+//   json_fuzz [--iterations N] [--seed S] [corpus_dir]
+// Built with JSON_FUZZ_LIBFUZZER (and -fsanitize=fuzzer) only LLVMFuzzerTestOneInput is compiled, for libFuzzer to drive.
+// Otherwise main mutates a corpus of valid documents itself, then checks that pathological inputs scale linearly.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+
+#include "general/file/file_view.hpp"
+#include "general/file/json.hpp"
+#include "general/file/json_binary.hpp"
+#include "general/file/json_events.hpp"
+#include "general/file/json_lazy.hpp"
+
+namespace fs = std::filesystem;
+using namespace spellbook;
+
+struct counting_handler : json_handler {
+    uint64 events = 0;
+    void begin_object() override { events++; }
+    void end_object() override { events++; }
+    void begin_list() override { events++; }
+    void end_list() override { events++; }
+    void key(string_view key) override { events++; }
+    void string_value(string_view value) override { events++; }
+    void int_value(int64 value) override { events++; }
+    void double_value(double value) override { events++; }
+    void bool_value(bool value) override { events++; }
+    void null_value() override { events++; }
+};
+
+static uint64 walk(const json_node& node) {
+    uint64 count = 1;
+    for (json_node element : node.elements())
+        count += walk(element);
+    for (auto [key, value] : node.members())
+        count += walk(value);
+    return count;
+}
+
+static void check(bool condition, const char* what, span<const uint8> input) {
+    if (condition)
+        return;
+    printf("failed: %s, input of %zu bytes written to json_fuzz_failure.bin\n", what, input.size());
+    if (FILE* f = fopen("json_fuzz_failure.bin", "wb")) {
+        fwrite(input.data(), 1, input.size(), f);
+        fclose(f);
+    }
+    abort();
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8* data, size_t size) {
+    span<const uint8> input(data, size);
+    string_view text((const char*) data, size);
+
+    json_error error;
+    json j = parse(text, &error);
+    // whatever parsed cleanly has to survive a round trip unchanged
+    if (!error) {
+        string dumped = dump_json(j);
+        json_error reparse_error;
+        json again = parse(dumped, &reparse_error);
+        check(!reparse_error, "dump of a parsed document doesn't parse", input);
+        // member order can change between parses, the length can't
+        check(dump_json(again).size() == dumped.size(), "dump of a parsed document doesn't round trip", input);
+
+        vector<uint8> binary;
+        write_json_binary(j, binary);
+        json decoded;
+        check(read_json_binary(span<const uint8>(binary.data(), binary.size()), decoded), "binary encoding doesn't decode", input);
+        check(dump_json(decoded).size() == dumped.size(), "binary encoding doesn't round trip", input);
+    }
+
+    json_document document = parse_document(text);
+    if (!document.failed)
+        walk(document.root());
+
+    counting_handler handler;
+    parse_events(text, handler);
+
+    lazy_json lazy = parse_lazy(string(text));
+    lazy.materialize();
+
+    json_error item_error;
+    parse_item(text, &item_error);
+
+    json binary;
+    read_json_binary(input, binary);
+    return 0;
+}
+
+#ifndef JSON_FUZZ_LIBFUZZER
+
+static uint64 rng_state = 0x9E3779B97F4A7C15ull;
+
+static uint64 next_random() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static void run_input(const string& input) {
+    LLVMFuzzerTestOneInput((const uint8*) input.data(), input.size());
+}
+
+static string mutate(const vector<string>& corpus) {
+    string input = corpus[next_random() % corpus.size()];
+    static const char tokens[] = "{}[]\":,\\tfn0-.eE \n";
+    uint32 mutations = 1 + next_random() % 8;
+    for (uint32 m = 0; m < mutations; m++) {
+        uint64 at = input.empty() ? 0 : next_random() % input.size();
+        switch (next_random() % 6) {
+            case 0: if (!input.empty()) input[at] = char(next_random()); break;
+            case 1: input.insert(input.begin() + at, tokens[next_random() % (sizeof(tokens) - 1)]); break;
+            case 2: if (!input.empty()) input.erase(at, 1 + next_random() % 16); break;
+            case 3: input.resize(at); break;
+            case 4: {
+                // duplicate a slice, which grows nesting and repeats keys
+                uint64 length = input.empty() ? 0 : next_random() % (input.size() - at + 1);
+                input.insert(at, input.substr(at, length));
+            } break;
+            case 5: {
+                const string& other = corpus[next_random() % corpus.size()];
+                input.insert(at, other.substr(0, next_random() % (other.size() + 1)));
+            } break;
+        }
+        if (input.size() > 1024 * 1024)
+            input.resize(1024 * 1024);
+    }
+    return input;
+}
+
+static double time_input(const string& input) {
+    auto start = std::chrono::steady_clock::now();
+    run_input(input);
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static string repeat(string_view prefix, string_view unit, uint32 count, string_view suffix) {
+    string out(prefix);
+    out.reserve(prefix.size() + unit.size() * count + suffix.size());
+    for (uint32 i = 0; i < count; i++)
+        out += unit;
+    out += suffix;
+    return out;
+}
+
+// Inputs that would expose a parser rescanning what it already consumed. 8x the size has to stay well under 64x the time.
+static bool check_scaling() {
+    struct shape {
+        const char* name;
+        string (*make)(uint32 count);
+    };
+    shape shapes[] = {
+        {"deep nesting", [](uint32 n) { return repeat("{\"a\":", "[", n, ""); }},
+        {"deep objects", [](uint32 n) { return repeat("", "{\"a\":", n, ""); }},
+        {"many keys", [](uint32 n) {
+            string out = "{";
+            for (uint32 i = 0; i < n; i++)
+                out += "\"key" + std::to_string(i) + "\":" + std::to_string(i) + ",";
+            return out + "\"end\":0}";
+        }},
+        {"duplicate keys", [](uint32 n) { return repeat("{", "\"same\":[1,2],", n, "\"same\":0}"); }},
+        {"escaped string", [](uint32 n) { return repeat("{\"s\":\"", "\\n\\u00e9\\\"", n, "\"}"); }},
+        {"unterminated", [](uint32 n) { return repeat("{\"s\":\"", "abcdefgh", n, ""); }},
+        {"bare commas", [](uint32 n) { return repeat("{\"l\":[", ",", n, "]}"); }},
+        {"long number", [](uint32 n) { return repeat("{\"n\":", "9", n, "}"); }},
+        {"missing colons", [](uint32 n) { return repeat("{", "\"k\" 1,", n, "}"); }},
+    };
+
+    bool ok = true;
+    for (const shape& s : shapes) {
+        string small = s.make(20000);
+        string large = s.make(160000);
+        // warm up, then take the faster of two so one slow run doesn't decide it
+        time_input(small);
+        double small_ms = std::min(time_input(small), time_input(small));
+        double large_ms = std::min(time_input(large), time_input(large));
+        double ratio = large_ms / std::max(small_ms, 0.05);
+        bool linear = ratio < 64.0;
+        printf("  %-16s %8.2f ms -> %8.2f ms (x%.1f) %s\n", s.name, small_ms, large_ms, ratio, linear ? "" : "QUADRATIC");
+        ok &= linear;
+    }
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    uint64 iterations = 100000;
+    vector<string> corpus = {
+        "{}",
+        "{\"a\":1,\"b\":[1,2.5,-3e10,true,false,null],\"c\":{\"d\":\"e\\\"\\u00e9\\ud83d\\ude00\"}}",
+        "{\"dependencies\":[\"a/b.sbjgen\"],\"data\":{\"position\":[1,2,3],\"name\":\"x\"}}",
+        "{\"deep\":[[[[[[{\"x\":[[[]]]}]]]]]]}",
+        "\xEF\xBB\xBF{\"bom\":\"yes\"}",
+    };
+    for (int32 i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc) {
+            iterations = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            rng_state = strtoull(argv[++i], nullptr, 10) | 1;
+        } else if (fs::is_directory(arg)) {
+            for (const fs::directory_entry& entry : fs::recursive_directory_iterator(arg)) {
+                FileView file(entry.path().string());
+                if (entry.is_regular_file() && file.opened && file.size < 1024 * 1024)
+                    corpus.push_back(string(file.view()));
+            }
+        }
+    }
+
+    // the binary encodings of the corpus are mutated too
+    uint64 text_seeds = corpus.size();
+    for (uint64 i = 0; i < text_seeds; i++) {
+        vector<uint8> binary;
+        write_json_binary(parse(corpus[i]), binary);
+        corpus.push_back(string((const char*) binary.data(), binary.size()));
+    }
+
+    for (const string& seed : corpus)
+        run_input(seed);
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64 i = 0; i < iterations; i++) {
+        run_input(mutate(corpus));
+        if ((i + 1) % 10000 == 0)
+            printf("%llu inputs\n", (unsigned long long) (i + 1));
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%llu mutated inputs in %.1fs without a crash\n", (unsigned long long) iterations, seconds);
+
+    printf("scaling\n");
+    return check_scaling() ? 0 : 1;
+}
+
+#endif
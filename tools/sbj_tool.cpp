@@ -0,0 +1,105 @@
+// Converts every .sbj* resource under a directory between the text and binary json encodings.
+//   sbj_tool binary <source_dir> <output_dir>
+//   sbj_tool text <source_dir> <output_dir> [--pretty]
+// Either encoding is accepted as input, the directory layout is mirrored into output_dir.
+// Or packs a whole content directory into one file for mount_pack, optionally compressed and with binary resources.
+//   sbj_tool pack <content_dir> <pack_file> [--compress] [--binary]
+
+#include <cstdio>
+#include <filesystem>
+
+#include "general/file/json.hpp"
+#include "general/file/json_binary.hpp"
+#include "general/file/pack.hpp"
+
+namespace fs = std::filesystem;
+using namespace spellbook;
+
+static bool write_file(const fs::path& path, const void* data, uint64 size) {
+    std::error_code ec;
+    fs::create_directories(path.parent_path(), ec);
+    FILE* f = fopen(path.string().c_str(), "wb");
+    if (f == nullptr)
+        return false;
+    bool ok = fwrite(data, 1, size, f) == size;
+    ok &= fclose(f) == 0;
+    return ok;
+}
+
+static int pack(const string& content_dir, const string& pack_file, int argc, char** argv) {
+    PackOptions options;
+    for (int32 i = 4; i < argc; i++) {
+        string arg = argv[i];
+        options.compress |= arg == "--compress";
+        options.binary_json |= arg == "--binary";
+    }
+    PackResult result = write_pack(content_dir, pack_file, options);
+    if (!result.written) {
+        printf("failed to write %s\n", pack_file.c_str());
+        return 1;
+    }
+    printf("packed %u files, %llu -> %llu bytes\n", result.files, (unsigned long long) result.bytes_in, (unsigned long long) result.bytes_out);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 4) {
+        printf("usage: sbj_tool binary|text <source_dir> <output_dir> [--pretty]\n");
+        printf("       sbj_tool pack <content_dir> <pack_file> [--compress] [--binary]\n");
+        return 1;
+    }
+    string mode = argv[1];
+    if (mode == "pack")
+        return pack(argv[2], argv[3], argc, argv);
+    fs::path source_dir = argv[2];
+    fs::path output_dir = argv[3];
+    bool pretty = argc > 4 && string(argv[4]) == "--pretty";
+    if (mode != "binary" && mode != "text") {
+        printf("unknown mode %s\n", mode.c_str());
+        return 1;
+    }
+
+    uint32 converted = 0;
+    uint32 failed = 0;
+    uint64 bytes_in = 0;
+    uint64 bytes_out = 0;
+    for (const fs::directory_entry& entry : fs::recursive_directory_iterator(source_dir)) {
+        if (!entry.is_regular_file() || !entry.path().extension().string().starts_with(".sbj"))
+            continue;
+
+        json_error error;
+        json j = parse_file(entry.path().string(), &error);
+        if (error) {
+            printf("skipped %s, %s at byte %llu\n", entry.path().string().c_str(), error.reason, (unsigned long long) error.offset);
+            failed++;
+            continue;
+        }
+        fs::path output_path = output_dir / fs::relative(entry.path(), source_dir);
+        bool ok;
+        uint64 size;
+        if (mode == "binary") {
+            vector<uint8> out;
+            write_json_binary(j, out);
+            size = out.size();
+            ok = write_file(output_path, out.data(), size);
+        } else {
+            string out = dump_json(j, pretty);
+            size = out.size();
+            ok = write_file(output_path, out.data(), size);
+        }
+
+        if (!ok) {
+            printf("failed to write %s\n", output_path.string().c_str());
+            failed++;
+            continue;
+        }
+        converted++;
+        bytes_in += entry.file_size();
+        bytes_out += size;
+    }
+
+    printf("converted %u files, %llu -> %llu bytes\n", converted, (unsigned long long) bytes_in, (unsigned long long) bytes_out);
+    if (failed > 0)
+        printf("failed %u files\n", failed);
+    return failed == 0 ? 0 : 1;
+}